@@ -1,55 +1,414 @@
 #include <string>
 #include <vector>
-#include <iostream>
 #include <cstdlib>
 #include <cstdio>
 #include <cstring>
+#include <cctype>
 #include <cassert>
+#include <cfloat>
+#include <algorithm>
+#include <stdint.h>
+// find_eq() reads whole aligned blocks past the end of a string, which AddressSanitizer reports as an overflow, so
+// sanitized builds take the scalar loop. Defining ANYARG_NO_SIMD forces it too, e.g. to keep <emmintrin.h> out of
+// programs using Anyarg header-only.
+#if defined(__SSE2__) && !defined(__SANITIZE_ADDRESS__) && !defined(ANYARG_NO_SIMD)
+#define ANYARG_SSE2
+#if defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#undef ANYARG_SSE2
+#endif
+#endif
+#endif
+#ifdef ANYARG_SSE2
+#include <emmintrin.h>
+#endif
 #include "anyarg.h"
 
 using std::string;
 using std::vector;
 
-#define ANYARG_TYPE_FLAG  1
-#define ANYARG_OPT_STR    2
-#define ANYARG_OPT_INT    3
-#define ANYARG_OPT_DOUBLE 4
+// Internal helpers, in a namespace of their own so that they stay out of programs including anyarg.h with
+// ANYARG_HEADER_ONLY
+namespace anyarg_detail {
+
+// kinds of command line arguments
+enum ArgKind {
+	ARG_PLAIN,  // non-option argument
+	ARG_STOP,   // --
+	ARG_LONG,   // --name or --name=value
+	ARG_SHORT   // -a, -abc or -ofoo
+};
+
+
+// Write an option as it is written in command line, "--name" or "-c", to s
+ANYARG_INLINE const char *option_label(const Option &opt, char *s, int size)
+{
+	if (opt.name.empty()) snprintf(s, size, "-%c", opt.letter);
+	else snprintf(s, size, "--%s", opt.name.c_str());
+	return s;
+}
+
+
+// FNV-1a hash of s[0..len)
+ANYARG_INLINE uint32_t hash_str(const char *s, int len)
+{
+	uint32_t h = 2166136261u;
+	for (int i = 0; i < len; i++) h = (h ^ (unsigned char)s[i]) * 16777619u;
+	return h;
+}
+
+
+// Parse a size, in bytes, such as 4096, 64K, 1MiB or 10MB. K, M, G, T, KiB, MiB, GiB and TiB are powers of 1024;
+// kB, MB, GB and TB are powers of 1000. Return false if s is invalid or overflows.
+ANYARG_INLINE bool parse_size(const char *s, uint64_t *size)
+{
+	const uint64_t max = ~(uint64_t)0;
+	const char *p = s;
+	uint64_t v = 0;
+	if (!isdigit((unsigned char)*p)) return false;
+	for (; isdigit((unsigned char)*p); p++) {
+		if (v > (max - (*p - '0')) / 10) return false;
+		v = v * 10 + (*p - '0');
+	}
+
+	uint64_t unit = 1;
+	if (*p && strcmp(p, "B") != 0) {
+		const char *units = "KMGT";
+		const char *u = strchr(units, toupper((unsigned char)*p));
+		if (u == NULL) return false;
+		int base;
+		if (p[1] == 0 || strcmp(p + 1, "iB") == 0) base = 1024;
+		else if (strcmp(p + 1, "B") == 0) base = 1000;
+		else return false;
+		for (int e = u - units; e >= 0; e--) unit *= base;
+	}
+	if (v > max / unit) return false;
+	*size = v * unit;
+	return true;
+}
+
+
+// Parse a duration, in nanoseconds, such as 250ms or 1h30m. Units are ns, us, ms, s, m or min, and h; a single count
+// without unit is in seconds. Return false if s is invalid or overflows.
+ANYARG_INLINE bool parse_duration(const char *s, int64_t *ns)
+{
+	const int64_t max = (int64_t)(~(uint64_t)0 >> 1);
+	const int64_t sec = 1000000000;
+	const char *p = s;
+	int64_t total = 0;
+	if (*p == 0) return false;
+	while (*p) {
+		int64_t v = 0;
+		if (!isdigit((unsigned char)*p)) return false;
+		for (; isdigit((unsigned char)*p); p++) {
+			if (v > (max - (*p - '0')) / 10) return false;
+			v = v * 10 + (*p - '0');
+		}
+
+		int64_t unit;
+		if (*p == 0 && total == 0 && p == s + strspn(s, "0123456789")) unit = sec;
+		else if (strncmp(p, "ns", 2) == 0) { unit = 1; p += 2; }
+		else if (strncmp(p, "us", 2) == 0) { unit = 1000; p += 2; }
+		else if (strncmp(p, "ms", 2) == 0) { unit = 1000000; p += 2; }
+		else if (strncmp(p, "min", 3) == 0) { unit = 60 * sec; p += 3; }
+		else if (*p == 's') { unit = sec; p++; }
+		else if (*p == 'm') { unit = 60 * sec; p++; }
+		else if (*p == 'h') { unit = 3600 * sec; p++; }
+		else return false;
+
+		if (v > (max - total) / unit) return false;
+		total += v * unit;
+	}
+	*ns = total;
+	return true;
+}
+
+
+// Order option indices by long name
+struct NameLess
+{
+	const vector<Option> &opts;
+	NameLess(const vector<Option> &o): opts(o) {}
+	bool operator () (int a, int b) const { return opts[a].name < opts[b].name; }
+};
+
+
+// Levenshtein distance between a[0..la) and b[0..lb) if it is at most tol, tol + 1 otherwise. Only the band of
+// cells within tol of the diagonal is computed, and the scan stops at the first row whose cells all exceed tol.
+ANYARG_INLINE int edit_distance(const char *a, int la, const char *b, int lb, int tol, vector<int> &row)
+{
+	if (la - lb > tol || lb - la > tol) return tol + 1;
+	row.resize(lb + 1);
+	for (int j = 0; j <= lb; j++) row[j] = j <= tol ? j : tol + 1;
+	for (int i = 1; i <= la; i++) {
+		int lo = i - tol > 1 ? i - tol : 1, hi = i + tol < lb ? i + tol : lb;
+		int diag = row[lo - 1]; // row[j - 1] of the previous line
+		row[lo - 1] = lo == 1 && i <= tol ? i : tol + 1;
+		int low = row[lo - 1];
+		for (int j = lo; j <= hi; j++) {
+			int d = diag + (a[i - 1] != b[j - 1]);
+			if (row[j] + 1 < d) d = row[j] + 1;
+			if (row[j - 1] + 1 < d) d = row[j - 1] + 1;
+			if (d > tol) d = tol + 1;
+			diag = row[j];
+			row[j] = d;
+			if (d < low) low = d;
+		}
+		if (low > tol) return tol + 1;
+	}
+	return row[lb];
+}
+
+
+// Find the long names nearest to name[0..len), at most nbest of them and within distance tol, among opts[index[k]]
+// sorted by name. Names are filtered by length first, and once nbest are found the bound shrinks to the farthest
+// kept, so each query is one bounded pass over the names. Returns the number found, nearest first, ties in name order.
+ANYARG_INLINE int nearest_names(const char *name, int len, int tol, const vector<Option> &opts,
+                                const vector<int> &index, int *best, int nbest, vector<int> &row)
+{
+	int bestd[8], nfound = 0; // nbest <= 8
+	for (size_t k = 0; k < index.size(); k++) {
+		int lim = nfound < nbest ? tol : bestd[nbest - 1] - 1; // a tie with the last kept comes later in name order
+		if (lim < 0) break;
+		const string &p = opts[index[k]].name;
+		int lp = p.length();
+		if (lp - len > lim || len - lp > lim) continue;
+		int d = edit_distance(name, len, p.c_str(), lp, lim, row);
+		if (d > lim) continue;
+		int i = nfound < nbest ? nfound++ : nbest - 1;
+		for (; i > 0 && bestd[i - 1] > d; i--) { best[i] = best[i - 1]; bestd[i] = bestd[i - 1]; }
+		best[i] = index[k];
+		bestd[i] = d;
+	}
+	return nfound;
+}
+
+
+// Set the default value and META word of a size or duration option
+ANYARG_INLINE void set_default_unit(Option &t, const char *v0)
+{
+	bool ok;
+	if (t.type == Option::OPT_SIZE) {
+		if (t.meta.empty()) t.meta = "SIZE";
+		ok = v0 && parse_size(v0, &t.value_size);
+	} else {
+		if (t.meta.empty()) t.meta = "DURATION";
+		ok = v0 && parse_duration(v0, &t.value_duration);
+	}
+	if (!ok) {
+		char s[80];
+		fprintf(stderr, "invalid default value %s of option %s.\n", v0 ? v0 : "NULL", option_label(t, s, sizeof(s)));
+		exit(1);
+	}
+}
+
+
+// Find the first '=' or NUL in s. The SSE2 version only reads aligned 16-byte blocks, which never cross a page
+// boundary, so reading past the end of s can not fault.
+ANYARG_INLINE const char *find_eq(const char *s)
+{
+#ifdef ANYARG_SSE2
+	const __m128i eq = _mm_set1_epi8('='), nul = _mm_setzero_si128();
+	int off = (uintptr_t)s & 15;
+	const __m128i *p = (const __m128i *)(s - off);
+	__m128i b = _mm_load_si128(p);
+	unsigned m = (unsigned)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(b, eq), _mm_cmpeq_epi8(b, nul))) >> off;
+	if (m) return s + __builtin_ctz(m);
+	for (;;) {
+		b = _mm_load_si128(++p);
+		m = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(b, eq), _mm_cmpeq_epi8(b, nul)));
+		if (m) return (const char *)p + __builtin_ctz(m);
+	}
+#else
+	while (*s && *s != '=') ++s;
+	return s;
+#endif
+}
+
+
+// Classify a command line argument. For a long option, *eq is set to the '=' or the NUL ending its name.
+ANYARG_INLINE int classify_arg(const char *s, const char **eq)
+{
+	if (s[0] != '-' || s[1] == 0) return ARG_PLAIN; // "-" is an ordinary argument
+	if (s[1] != '-') return ARG_SHORT;
+	if (s[2] == 0) return ARG_STOP;
+	*eq = find_eq(s + 2);
+	return ARG_LONG;
+}
+
+
+ANYARG_INLINE int lowest_bit(uint64_t m)
+{
+	int k = 0;
+	while (!(m >> k & 1)) k++;
+	return k;
+}
+
+
+// Append s to a shell script inside single quotes. esc is the replacement of a single quote and extra is the set
+// of characters to be escaped by a backslash.
+ANYARG_INLINE void append_quoted(string &script, const string &s, const char *esc, const char *extra)
+{
+	script.push_back('\'');
+	for (size_t i = 0; i < s.length(); i++) {
+		if (s[i] == '\'') script.append(esc);
+		else {
+			if (strchr(extra, s[i])) script.push_back('\\');
+			script.push_back(s[i]);
+		}
+	}
+	script.push_back('\'');
+}
+
+
+// Completion of an option argument: 'f' for files, 'd' for directories, 0 for nothing.
+ANYARG_INLINE char meta_completion(const string &meta)
+{
+	if (meta == "FILE" || meta == "PATH") return 'f';
+	if (meta == "DIR") return 'd';
+	return 0;
+}
+
+
+ANYARG_INLINE const char *type_name(int type)
+{
+	switch (type) {
+		case Option::TYPE_FLAG: return "flag";
+		case Option::OPT_STR: return "str";
+		case Option::OPT_INT: return "int";
+		case Option::OPT_DOUBLE: return "double";
+		case Option::OPT_SIZE: return "size";
+		case Option::OPT_DURATION: return "duration";
+		default: return "unknown";
+	}
+}
+
+
+// Format a non-string option value, the shortest form which reads back the same double
+ANYARG_INLINE const char *format_value(const Option &opt, char *s, int size)
+{
+	switch (opt.type) {
+		case Option::TYPE_FLAG:
+			return opt.value_bool ? "true" : "false";
+		case Option::OPT_INT:
+			snprintf(s, size, "%d", opt.value_int);
+			return s;
+		case Option::OPT_DOUBLE:
+			snprintf(s, size, "%.*g", DBL_DIG, opt.value_double);
+			if (strtod(s, NULL) != opt.value_double) snprintf(s, size, "%.17g", opt.value_double);
+			return s;
+		case Option::OPT_SIZE:
+			snprintf(s, size, "%llu", (unsigned long long)opt.value_size);
+			return s;
+		case Option::OPT_DURATION:
+			snprintf(s, size, "%lld", (long long)opt.value_duration);
+			return s;
+		default:
+			return "";
+	}
+}
+
+} // namespace anyarg_detail
 
 
 // Set option value given a string
-bool Option::set_value(const char *new_value)
+ANYARG_INLINE bool Option::set_value(const char *new_value)
 {
 	if (new_value == NULL || new_value[0] == 0) {
 		fprintf(stderr, "invalid option value\n");
 		exit(1);
 	}
 
+	char s[80];
 	switch (type)
 	{
-		case ANYARG_TYPE_FLAG: 
+		case TYPE_FLAG: 
 			if (strcmp(new_value, "true") == 0) value_bool = true;
 			else value_bool = false;
 			break;
-		case ANYARG_OPT_STR:
+		case OPT_STR:
 			value_str = new_value;
 			break;
-		case ANYARG_OPT_INT:
+		case OPT_INT:
 			value_int = atoi(new_value);
 			break;
-		case ANYARG_OPT_DOUBLE:
+		case OPT_DOUBLE:
 			value_double = atof(new_value);
 			break;
+		case OPT_SIZE:
+			if (!anyarg_detail::parse_size(new_value, &value_size)) {
+				fprintf(stderr, "invalid size %s of option %s.\n", new_value,
+				        anyarg_detail::option_label(*this, s, sizeof(s)));
+				exit(1);
+			}
+			break;
+		case OPT_DURATION:
+			if (!anyarg_detail::parse_duration(new_value, &value_duration)) {
+				fprintf(stderr, "invalid duration %s of option %s.\n", new_value,
+				        anyarg_detail::option_label(*this, s, sizeof(s)));
+				exit(1);
+			}
+			break;
 		default:
 			fprintf(stderr, "invalid option value type\n");
 			exit(1);
 	}
+
+	if (has_range) {
+		double v = type == OPT_INT ? value_int : value_double;
+		if (v < range_min || v > range_max) {
+			fprintf(stderr, "the value of option %s is out of range [%g, %g].\n",
+			        anyarg_detail::option_label(*this, s, sizeof(s)), range_min, range_max);
+			exit(1);
+		}
+	}
+	if (!choice_set.empty() && !is_choice(new_value)) {
+		fprintf(stderr, "invalid value %s of option %s, valid values: %s.\n", new_value,
+		        anyarg_detail::option_label(*this, s, sizeof(s)), choices.c_str());
+		exit(1);
+	}
 	
 	return true;
 }
 
 
+// Build the hash set of choices with linear probing, at most half full
+ANYARG_INLINE bool Option::set_choices(const char *list)
+{
+	choices = list;
+	int n = 1;
+	for (const char *p = list; *p; p++) n += *p == '|';
+	int size = 4;
+	while (size < 2 * n) size *= 2;
+	choice_set.assign(size, string());
+	for (const char *p = list; ; ) {
+		const char *e = strchr(p, '|');
+		int len = e ? e - p : strlen(p);
+		if (len > 0) { // an empty value is never given
+			uint32_t k = anyarg_detail::hash_str(p, len) & (size - 1);
+			while (!choice_set[k].empty() && choice_set[k].compare(0, string::npos, p, len) != 0)
+				k = (k + 1) & (size - 1);
+			choice_set[k].assign(p, len);
+		}
+		if (e == NULL) break;
+		p = e + 1;
+	}
+	return true;
+}
+
+
+// Look up a value in the hash set of choices, whose size is a power of 2
+ANYARG_INLINE bool Option::is_choice(const char *value) const
+{
+	uint32_t mask = choice_set.size() - 1;
+	for (uint32_t k = anyarg_detail::hash_str(value, strlen(value)) & mask; !choice_set[k].empty(); k = (k + 1) & mask)
+		if (choice_set[k] == value) return true;
+	return false;
+}
+
+
 // set the desc and meta
-bool Option::set_desc_meta(const char *s)
+ANYARG_INLINE bool Option::set_desc_meta(const char *s)
 {
 	if (s && s[0]) {
 		if (s[0] == '=') { // has a meta word
@@ -66,16 +425,20 @@ bool Option::set_desc_meta(const char *s)
 }
 
 
-Anyarg::Anyarg(): prog_name_(), argc_(0), argv_(), options_(), help_() {}
+ANYARG_INLINE Anyarg::Anyarg(): prog_name_(), argc_(0), argv_(), options_(), find_name_(0), find_letter_(0), find_order_(0),
+	nfind_(0),
+	name_index_(), set_mask_(), exclusive_(), requirer_(), requires_(), help_(), script_() {}
 
 
-int Anyarg::get_optind(const char *name) const
+ANYARG_INLINE int Anyarg::get_optind(const char *name) const
 {
 	if (name == NULL || name[0] == 0) {
 		fprintf(stderr, "invalid option name\n");
 		exit(1);
 	}
 	
+	if (find_name_ && (size_t)nfind_ == options_.size()) return find_name_(name, strlen(name));
+
 	for (int i = 0; i < options_.size(); i++) {
 		if (options_[i].name.empty()) continue;
 		if (options_[i].name == name) return i;
@@ -84,13 +447,15 @@ int Anyarg::get_optind(const char *name) const
 }
 
 
-int Anyarg::get_optind(char letter) const
+ANYARG_INLINE int Anyarg::get_optind(char letter) const
 {
 	if (letter == 0) {
 		fprintf(stderr, "invalid option\n");
 		exit(1);
 	}
 
+	if (find_letter_ && (size_t)nfind_ == options_.size()) return find_letter_[(unsigned char)letter];
+
 	for (int i = 0; i < options_.size(); i++)
 		if (options_[i].letter == letter) return i;
 
@@ -98,7 +463,71 @@ int Anyarg::get_optind(char letter) const
 }
 
 
-bool Anyarg::is_new_option(const char *name, char letter)
+ANYARG_INLINE void Anyarg::build_name_index()
+{
+	name_index_.clear();
+	name_index_.reserve(options_.size());
+	for (size_t i = 0; i < options_.size(); i++)
+		if (!options_[i].name.empty()) name_index_.push_back(i);
+	if (find_order_ && (size_t)nfind_ == options_.size()) // sorted by anyarg-gen already
+		name_index_.assign(find_order_, find_order_ + name_index_.size());
+	else std::sort(name_index_.begin(), name_index_.end(), anyarg_detail::NameLess(options_));
+}
+
+
+// Long names sharing a prefix are adjacent in name_index_, so two binary searches give all of them.
+ANYARG_INLINE void Anyarg::prefix_range(const char *name, int len, int &first, int &last) const
+{
+	int lo = 0, hi = name_index_.size();
+	while (lo < hi) { // first name >= prefix
+		int mid = (lo + hi) / 2;
+		if (strncmp(options_[name_index_[mid]].name.c_str(), name, len) < 0) lo = mid + 1;
+		else hi = mid;
+	}
+	first = lo;
+	hi = name_index_.size();
+	while (lo < hi) { // first name beyond the prefix
+		int mid = (lo + hi) / 2;
+		if (strncmp(options_[name_index_[mid]].name.c_str(), name, len) <= 0) lo = mid + 1;
+		else hi = mid;
+	}
+	last = lo;
+}
+
+
+// An exact match always wins, even if it is also a prefix of other names (--min vs --min-len).
+ANYARG_INLINE int Anyarg::match_optind(const char *name, int len) const
+{
+	int first, last;
+	prefix_range(name, len, first, last);
+
+	if (first == last) return -1;
+	if (last - first == 1 || options_[name_index_[first]].name.length() == (size_t)len)
+		return name_index_[first];
+
+	fprintf(stderr, "option --%.*s is ambiguous; possibilities:", len, name);
+	for (int k = first; k < last; k++) fprintf(stderr, " --%s", options_[name_index_[k]].name.c_str());
+	fprintf(stderr, "\n");
+	exit(1);
+}
+
+
+ANYARG_INLINE void Anyarg::suggest_options(const char *name, int len)
+{
+	const int nbest = 3;        // at most 3 suggestions
+	int tol = len > 3 ? 2 : 1;  // misses farther than this are not suggested
+	int best[nbest];
+	vector<int> row;
+	int nfound = anyarg_detail::nearest_names(name, len, tol, options_, name_index_, best, nbest, row);
+
+	if (nfound == 0) return;
+	fprintf(stderr, "did you mean");
+	for (int k = 0; k < nfound; k++) fprintf(stderr, "%s --%s", k ? "," : "", options_[best[k]].name.c_str());
+	fprintf(stderr, "?\n");
+}
+
+
+ANYARG_INLINE bool Anyarg::is_new_option(const char *name, char letter)
 {
 	if ((name == NULL || name[0] == 0) && letter == 0) {
 		fprintf(stderr, "%s line %d: invalid option\n", __FILE__, __LINE__);
@@ -106,11 +535,9 @@ bool Anyarg::is_new_option(const char *name, char letter)
 	}
 
 	// check whether the option has been defined
-	int found = 0;
 	if (name && name[0]) {
 		int j = get_optind(name);
 		if (j >= 0) {
-			found = 1;
 			fprintf(stderr, "option --%s has been defined\n", name);
 			exit(1);
 		}
@@ -118,7 +545,6 @@ bool Anyarg::is_new_option(const char *name, char letter)
 	if (letter) {
 		int j = get_optind(letter);
 		if (j >= 0) {
-			found = 1;
 			fprintf(stderr, "option -%c has been defined\n", letter);
 			exit(1);
 		}
@@ -129,102 +555,391 @@ bool Anyarg::is_new_option(const char *name, char letter)
 }
 
 
-bool Anyarg::add_flag(const char *name, char letter, const char *desc)
+ANYARG_INLINE bool Anyarg::add_flag(const char *name, char letter, const char *desc)
 {
 	assert(is_new_option(name, letter));
 
-	Option t;
-	t.type = ANYARG_TYPE_FLAG;
+	options_.push_back(Option()); // fill in place, copying an Option would copy its strings
+	Option &t = options_.back();
+	t.type = Option::TYPE_FLAG;
 	t.letter = letter;
 	if (name && name[0]) t.name = name;
 	else t.name = "";
 	t.value_bool = false;
 	t.desc = desc;
 	t.meta = "";
-	options_.push_back(t);
 	return 1;
 }
 
 
-bool Anyarg::add_flag(char letter, const char *desc)
+ANYARG_INLINE bool Anyarg::add_flag(char letter, const char *desc)
 {
 	return add_flag("", letter, desc);
 }
 
 
-bool Anyarg::add_option_str(const char *name, char letter, const char *v0, const char *desc)
+ANYARG_INLINE bool Anyarg::add_option_str(const char *name, char letter, const char *v0, const char *desc)
 {
 	assert(is_new_option(name, letter));
 
-	Option t;
-	t.type = ANYARG_OPT_STR;
+	options_.push_back(Option());
+	Option &t = options_.back();
+	t.type = Option::OPT_STR;
 	t.letter = letter;
 	if (name && name[0]) t.name = name;
 	else t.name = "";
 	t.value_str = v0;
 	t.set_desc_meta(desc);
-	
-	options_.push_back(t);
 	return 1;
 }
 
 
-bool Anyarg::add_option_str(char letter, const char *v0, const char *desc)
+ANYARG_INLINE bool Anyarg::add_option_str(char letter, const char *v0, const char *desc)
 {
 	return add_option_str("", letter, v0, desc);
 }
 
 
-bool Anyarg::add_option_int(const char *name, char letter, int v0, const char *desc)
+ANYARG_INLINE bool Anyarg::add_option_int(const char *name, char letter, int v0, const char *desc)
 {
 	assert(is_new_option(name, letter));
 
-	Option t;
-	t.type = ANYARG_OPT_INT;
+	options_.push_back(Option());
+	Option &t = options_.back();
+	t.type = Option::OPT_INT;
 	t.letter = letter;
 	if (name && name[0]) t.name = name;
 	else t.name = "";
 	t.value_int = v0;
 	t.set_desc_meta(desc);
-	
-	options_.push_back(t);
 	return 1;
 }
 
 
-bool Anyarg::add_option_int(char letter, int v0, const char *desc)
+ANYARG_INLINE bool Anyarg::add_option_int(char letter, int v0, const char *desc)
 {
 	return add_option_int("", letter, v0, desc);
 }
 
 
-bool Anyarg::add_option_double(const char *name, char letter, double v0, const char *desc)
+ANYARG_INLINE bool Anyarg::add_option_double(const char *name, char letter, double v0, const char *desc)
 {
 	assert(is_new_option(name, letter));
 
-	Option t;
-	t.type = ANYARG_OPT_DOUBLE;
+	options_.push_back(Option());
+	Option &t = options_.back();
+	t.type = Option::OPT_DOUBLE;
 	t.letter = letter;
 	if (name && name[0]) t.name = name;
 	else t.name = "";
 	t.value_double = v0;
 	t.set_desc_meta(desc);
-	
-	options_.push_back(t);
 	return 1;
 }
 
 
-bool Anyarg::add_option_double(char letter, double v0, const char *desc)
+ANYARG_INLINE bool Anyarg::add_option_double(char letter, double v0, const char *desc)
 {
 	return add_option_double("", letter, v0, desc);
 }
 
 
+ANYARG_INLINE bool Anyarg::add_option_size(const char *name, char letter, const char *v0, const char *desc)
+{
+	assert(is_new_option(name, letter));
+
+	options_.push_back(Option());
+	Option &t = options_.back();
+	t.type = Option::OPT_SIZE;
+	t.letter = letter;
+	if (name && name[0]) t.name = name;
+	else t.name = "";
+	t.set_desc_meta(desc);
+	anyarg_detail::set_default_unit(t, v0);
+	return 1;
+}
+
+
+ANYARG_INLINE bool Anyarg::add_option_size(char letter, const char *v0, const char *desc)
+{
+	return add_option_size("", letter, v0, desc);
+}
+
+
+ANYARG_INLINE bool Anyarg::add_option_duration(const char *name, char letter, const char *v0, const char *desc)
+{
+	assert(is_new_option(name, letter));
+
+	options_.push_back(Option());
+	Option &t = options_.back();
+	t.type = Option::OPT_DURATION;
+	t.letter = letter;
+	if (name && name[0]) t.name = name;
+	else t.name = "";
+	t.set_desc_meta(desc);
+	anyarg_detail::set_default_unit(t, v0);
+	return 1;
+}
+
+
+ANYARG_INLINE bool Anyarg::add_option_duration(char letter, const char *v0, const char *desc)
+{
+	return add_option_duration("", letter, v0, desc);
+}
+
+
+ANYARG_INLINE bool Anyarg::add_options(const OptionSpec *specs, int n, int (*find)(const char *, int),
+                                        const short *letters, const short *order)
+{
+	if (!options_.empty()) { // the lookups do not cover existing options
+		for (int i = 0; i < n; i++) {
+			const OptionSpec &t = specs[i];
+			switch (t.valtype) {
+				case 'B': add_flag(t.name, t.letter, t.desc); break;
+				case 'S': add_option_str(t.name, t.letter, t.v0, t.desc); break;
+				case 'I': add_option_int(t.name, t.letter, atoi(t.v0), t.desc); break;
+				case 'D': add_option_double(t.name, t.letter, atof(t.v0), t.desc); break;
+				case 'Z': add_option_size(t.name, t.letter, t.v0, t.desc); break;
+				case 'T': add_option_duration(t.name, t.letter, t.v0, t.desc); break;
+				default:
+					fprintf(stderr, "invalid option value type\n");
+					exit(1);
+			}
+		}
+		return 1;
+	}
+
+	options_.resize(n);
+	for (int i = 0; i < n; i++) {
+		const OptionSpec &s = specs[i];
+		Option &t = options_[i];
+		t.letter = s.letter;
+		t.name = s.name;
+		switch (s.valtype) {
+			case 'B':
+				t.type = Option::TYPE_FLAG;
+				t.value_bool = false;
+				t.desc = s.desc;
+				break;
+			case 'S':
+				t.type = Option::OPT_STR;
+				t.value_str = s.v0;
+				t.set_desc_meta(s.desc);
+				break;
+			case 'I':
+				t.type = Option::OPT_INT;
+				t.value_int = atoi(s.v0);
+				t.set_desc_meta(s.desc);
+				break;
+			case 'D':
+				t.type = Option::OPT_DOUBLE;
+				t.value_double = atof(s.v0);
+				t.set_desc_meta(s.desc);
+				break;
+			case 'Z':
+			case 'T':
+				t.type = s.valtype == 'Z' ? Option::OPT_SIZE : Option::OPT_DURATION;
+				t.set_desc_meta(s.desc);
+				anyarg_detail::set_default_unit(t, s.v0);
+				break;
+			default:
+				fprintf(stderr, "invalid option value type\n");
+				exit(1);
+		}
+	}
+	find_name_ = find;
+	find_letter_ = letters;
+	find_order_ = order;
+	nfind_ = n;
+	return 1;
+}
+
+
+ANYARG_INLINE bool Anyarg::set_range(const char *name, double lo, double hi)
+{
+	int j = get_optind(name);
+
+	if (j < 0) {
+		fprintf(stderr, "option --%s is undefined.\n", name);
+		exit(1);
+	}
+	if (options_[j].type != Option::OPT_INT && options_[j].type != Option::OPT_DOUBLE) {
+		fprintf(stderr, "option --%s is not a option with a numeric value.\n", name);
+		exit(1);
+	}
+	if (!(lo <= hi)) {
+		fprintf(stderr, "invalid range [%g, %g] of option --%s.\n", lo, hi, name);
+		exit(1);
+	}
+	options_[j].has_range = true;
+	options_[j].range_min = lo;
+	options_[j].range_max = hi;
+	return 1;
+}
+
+
+ANYARG_INLINE bool Anyarg::set_range(char letter, double lo, double hi)
+{
+	int j = get_optind(letter);
+
+	if (j < 0) {
+		fprintf(stderr, "option -%c is undefined.\n", letter);
+		exit(1);
+	}
+	if (options_[j].type != Option::OPT_INT && options_[j].type != Option::OPT_DOUBLE) {
+		fprintf(stderr, "option -%c is not a option with a numeric value.\n", letter);
+		exit(1);
+	}
+	if (!(lo <= hi)) {
+		fprintf(stderr, "invalid range [%g, %g] of option -%c.\n", lo, hi, letter);
+		exit(1);
+	}
+	options_[j].has_range = true;
+	options_[j].range_min = lo;
+	options_[j].range_max = hi;
+	return 1;
+}
+
+
+ANYARG_INLINE bool Anyarg::set_choices(const char *name, const char *choices)
+{
+	int j = get_optind(name);
+
+	if (j < 0) {
+		fprintf(stderr, "option --%s is undefined.\n", name);
+		exit(1);
+	}
+	if (options_[j].type != Option::OPT_STR) {
+		fprintf(stderr, "option --%s is not a option with a string value.\n", name);
+		exit(1);
+	}
+	return options_[j].set_choices(choices);
+}
+
+
+ANYARG_INLINE bool Anyarg::set_choices(char letter, const char *choices)
+{
+	int j = get_optind(letter);
+
+	if (j < 0) {
+		fprintf(stderr, "option -%c is undefined.\n", letter);
+		exit(1);
+	}
+	if (options_[j].type != Option::OPT_STR) {
+		fprintf(stderr, "option -%c is not a option with a string value.\n", letter);
+		exit(1);
+	}
+	return options_[j].set_choices(choices);
+}
+
+
+ANYARG_INLINE int Anyarg::token_optind(const char *s, int len) const
+{
+	int j = -1;
+	if (len == 2 && s[0] == '-' && s[1] != '-') j = get_optind(s[1]);
+	else if (len > 2 && s[0] == '-' && s[1] == '-') {
+		string name(s + 2, len - 2);
+		j = get_optind(name.c_str());
+	}
+	if (j < 0) {
+		fprintf(stderr, "option %.*s is undefined.\n", len, s);
+		exit(1);
+	}
+	return j;
+}
+
+
+ANYARG_INLINE void Anyarg::make_mask(const char *opts, vector<uint64_t> &mask) const
+{
+	mask.assign((options_.size() + 63) / 64, 0);
+	for (const char *p = opts; *p; ) {
+		while (*p && isspace((unsigned char)*p)) ++p;
+		const char *e = p;
+		while (*e && !isspace((unsigned char)*e)) ++e;
+		if (e > p) {
+			int j = token_optind(p, e - p);
+			mask[j / 64] |= (uint64_t)1 << (j % 64);
+		}
+		p = e;
+	}
+}
+
+
+ANYARG_INLINE bool Anyarg::add_exclusive(const char *opts)
+{
+	exclusive_.push_back(vector<uint64_t>());
+	make_mask(opts, exclusive_.back());
+	return 1;
+}
+
+
+ANYARG_INLINE bool Anyarg::add_requires(const char *opt, const char *opts)
+{
+	requirer_.push_back(token_optind(opt, strlen(opt)));
+	requires_.push_back(vector<uint64_t>());
+	make_mask(opts, requires_.back());
+	return 1;
+}
+
+
+ANYARG_INLINE void Anyarg::set_option(int j, const char *value)
+{
+	options_[j].set_value(value);
+	set_mask_[j / 64] |= (uint64_t)1 << (j % 64);
+}
+
+
+ANYARG_INLINE bool Anyarg::is_given(int j) const
+{
+	return (size_t)j / 64 < set_mask_.size() && (set_mask_[j / 64] >> (j % 64) & 1);
+}
+
+
+// Each group costs a few word operations, whatever the number of options in it.
+ANYARG_INLINE void Anyarg::check_groups() const
+{
+	char s1[80], s2[80];
+	for (size_t g = 0; g < exclusive_.size(); g++) {
+		const vector<uint64_t> &mask = exclusive_[g];
+		int first = -1;
+		for (size_t w = 0; w < mask.size(); w++) {
+			uint64_t m = mask[w] & set_mask_[w];
+			while (m) {
+				int j = w * 64 + anyarg_detail::lowest_bit(m);
+				if (first >= 0) {
+					fprintf(stderr, "option %s and %s cannot be given together.\n",
+					        anyarg_detail::option_label(options_[first], s1, sizeof(s1)),
+					        anyarg_detail::option_label(options_[j], s2, sizeof(s2)));
+					exit(1);
+				}
+				first = j;
+				m &= m - 1;
+			}
+		}
+	}
+
+	for (size_t g = 0; g < requires_.size(); g++) {
+		int r = requirer_[g];
+		if (!is_given(r)) continue;
+		const vector<uint64_t> &mask = requires_[g];
+		for (size_t w = 0; w < mask.size(); w++) {
+			uint64_t m = mask[w] & ~set_mask_[w];
+			if (m) {
+				int j = w * 64 + anyarg_detail::lowest_bit(m);
+				fprintf(stderr, "option %s requires option %s.\n",
+				        anyarg_detail::option_label(options_[r], s1, sizeof(s1)),
+				        anyarg_detail::option_label(options_[j], s2, sizeof(s2)));
+				exit(1);
+			}
+		}
+	}
+}
+
+
 // Turn on flags specified on command line
 // Get option values specified on command line
 // Collect non-option arguments
-bool Anyarg::parse_argv(int argc, char **argv)
+ANYARG_INLINE bool Anyarg::parse_argv(int argc, char **argv)
 {
 	prog_name_ = argv[0];
 	
@@ -233,86 +948,71 @@ bool Anyarg::parse_argv(int argc, char **argv)
 		exit(1);
 	}
 	
+	build_name_index();
+
 	argc_ = 0;
+	argv_.reserve(argv_.size() + argc - 1);
+	set_mask_.assign((options_.size() + 63) / 64, 0);
 	int stop_parsing = 0; // stop option parsing when meeting argument --
 	int j = 0;
-	string t;
 	for (int i = 1; i < argc; i++) {
-		if (stop_parsing) {
-			t = argv[i];
-			argv_.push_back(t); argc_++;
-			continue;
-		}
-		
-		if (argv[i][0] == '-' && argv[i][1] == 0) { // meet "-"
-			t = argv[i];
-			argv_.push_back(t); argc_++;
-			continue;
-		}
-		
-		if (argv[i][0] == '-' && argv[i][1] == '-' && argv[i][2] == 0) { // meet "--"
+		const char *eq = NULL;
+		int kind = stop_parsing ? anyarg_detail::ARG_PLAIN : anyarg_detail::classify_arg(argv[i], &eq);
+
+		if (kind == anyarg_detail::ARG_PLAIN) { // non-option arguments
+			argv_.push_back(argv[i]); argc_++;
+		} else if (kind == anyarg_detail::ARG_STOP) { // meet "--"
 			stop_parsing = 1;
-			continue;
-		} 
-		
-		if (argv[i][0] == '-' && argv[i][1] == '-') { // long option
-			char *x = strdup(argv[i] + 2);
-			int len = strlen(x);
-			int t = 0;
-			while (x[t] && x[t] != '=') t++; // seek for '='
-			if (t < len) { // a name=argument pair
-				x[t] = '\0';
-				j = get_optind(x);
-				if (j < 0) {
-					fprintf(stderr, "illegal option --%s.\n", x);
-					exit(1);
-				}
+		} else if (kind == anyarg_detail::ARG_LONG) { // long option, the name is x[0..len)
+			const char *x = argv[i] + 2;
+			int len = eq - x;
+			j = -1;
+			if (len && find_name_ && (size_t)nfind_ == options_.size()) j = find_name_(x, len); // exact name
+			if (len && j < 0) j = match_optind(x, len);
+			if (j < 0) {
+				fprintf(stderr, "illegal option --%.*s.\n", len, x);
+				suggest_options(x, len);
+				exit(1);
+			}
 
-				if (options_[j].type == ANYARG_TYPE_FLAG) {
-					fprintf(stderr, "option --%s is a flag, cannot taking a argument.\n", x);
+			if (*eq == '=') { // a name=argument pair
+				if (options_[j].type == Option::TYPE_FLAG) {
+					fprintf(stderr, "option --%.*s is a flag, cannot taking a argument.\n", len, x);
 					exit(1);
 				}
 				
-				if (t >= len - 1) {
-					fprintf(stderr, "the argument of option --%s is missed.\n", x);
+				if (eq[1] == 0) {
+					fprintf(stderr, "the argument of option --%.*s is missed.\n", len, x);
 					exit(1);
 				}
-				options_[j].set_value(x + t + 1);
+				set_option(j, eq + 1);
 			} else { // is --name or --name argument
-				j = get_optind(x);
-				if (j < 0) {
-					fprintf(stderr, "illegal option --%s.\n", x);
-					exit(1);
-				}
-
-				if (options_[j].type == ANYARG_TYPE_FLAG) {
-					options_[j].set_value("true");
+				if (options_[j].type == Option::TYPE_FLAG) {
+					set_option(j, "true");
 				} else {
 					if (i >= argc - 1) {
-						fprintf(stderr, "the argument of option --%s is missed.\n", x);
+						fprintf(stderr, "the argument of option --%.*s is missed.\n", len, x);
 						exit(1);
 					}
-					options_[j].set_value(argv[++i]);
+					set_option(j, argv[++i]);
 				}
 			}
-			free(x);
-		} else if (argv[i][0] == '-') { // short option
+		} else { // short option
 			const char *x = argv[i] + 1;
-			int len = strlen(x);
-			if (len == 1) { // is a regular short option
+			if (x[1] == 0) { // is a regular short option
 				j = get_optind(x[0]);
 				if (j < 0) {
 					fprintf(stderr, "illegal option -%c.\n", x[0]);
 					exit(1);
 				}
-				if (options_[j].type == ANYARG_TYPE_FLAG) {
-					options_[j].set_value("true");
+				if (options_[j].type == Option::TYPE_FLAG) {
+					set_option(j, "true");
 				} else {
 					if (i >= argc - 1) {
 						fprintf(stderr, "the argument of option -%c is missed.\n", x[0]);
 						exit(1);
 					}
-					options_[j].set_value(argv[++i]);
+					set_option(j, argv[++i]);
 				}
 			} else { // bundled flags ('-lst') or option-value pair ('-ofoo');
 				j = get_optind(x[0]);
@@ -320,33 +1020,32 @@ bool Anyarg::parse_argv(int argc, char **argv)
 					fprintf(stderr, "illegal option -%c.\n", x[0]);
 					exit(1);
 				}
-				if (options_[j].type != ANYARG_TYPE_FLAG) { // is option-value pair
-					options_[j].set_value(x + 1);
+				if (options_[j].type != Option::TYPE_FLAG) { // is option-value pair
+					set_option(j, x + 1);
 				} else { // is bundled flags
-					for (int t = 0; t < len; t++) {
+					for (int t = 0; x[t]; t++) {
 						j = get_optind(x[t]);
 						if (j < 0) {
 							fprintf(stderr, "illegal option -%c.\n", x[t]);
 							exit(1);
 						}
-						if (options_[j].type != ANYARG_TYPE_FLAG) {
+						if (options_[j].type != Option::TYPE_FLAG) {
 							fprintf(stderr, "-%c is not a flag, cannot be grouped.\n", x[t]);
 							exit(1);
 						}
-						options_[j].set_value("true");
+						set_option(j, "true");
 					}
 				}
 			}
-		} else { // non-option arguments
-			t = argv[i];
-			argv_.push_back(t); argc_++;
 		}
 	}
+
+	check_groups();
 	return 1;
 }
 
 
-bool Anyarg::is_true(const char *name) const
+ANYARG_INLINE bool Anyarg::is_true(const char *name) const
 {
 	int j = get_optind(name);
 
@@ -355,7 +1054,7 @@ bool Anyarg::is_true(const char *name) const
 		exit(1);
 	}
 	
-	if (options_[j].type != ANYARG_TYPE_FLAG) {
+	if (options_[j].type != Option::TYPE_FLAG) {
 		fprintf(stderr, "option --%s is not a flag.\n", name);
 		exit(1);
 	}
@@ -363,7 +1062,7 @@ bool Anyarg::is_true(const char *name) const
 }
 
 
-bool Anyarg::is_true(char letter) const
+ANYARG_INLINE bool Anyarg::is_true(char letter) const
 {
 	int j = get_optind(letter);
 
@@ -372,7 +1071,7 @@ bool Anyarg::is_true(char letter) const
 		exit(1);
 	}
 
-	if (options_[j].type != ANYARG_TYPE_FLAG) {
+	if (options_[j].type != Option::TYPE_FLAG) {
 		fprintf(stderr, "option -%c is not a flag.\n", letter);
 		exit(1);
 	}
@@ -381,7 +1080,7 @@ bool Anyarg::is_true(char letter) const
 }
 
 
-const char *Anyarg::get_value_str(const char *name) const
+ANYARG_INLINE const char *Anyarg::get_value_str(const char *name) const
 {
 	int j = get_optind(name);
 
@@ -389,7 +1088,7 @@ const char *Anyarg::get_value_str(const char *name) const
 		fprintf(stderr, "option --%s is undefined.\n", name);
 		exit(1);
 	}
-	if (options_[j].type != ANYARG_OPT_STR) {
+	if (options_[j].type != Option::OPT_STR) {
 		fprintf(stderr, "option --%s is not a option with a string value.\n", name);
 		exit(1);
 	}
@@ -397,7 +1096,7 @@ const char *Anyarg::get_value_str(const char *name) const
 }
 
 
-const char *Anyarg::get_value_str(char letter) const
+ANYARG_INLINE const char *Anyarg::get_value_str(char letter) const
 {
 	int j = get_optind(letter);
 
@@ -406,7 +1105,7 @@ const char *Anyarg::get_value_str(char letter) const
 		return 0;
 	}
 	
-	if (options_[j].type != ANYARG_OPT_STR) {
+	if (options_[j].type != Option::OPT_STR) {
 		fprintf(stderr, "option -%c is not a option with a string value.\n", letter);
 		return 0;
 	}
@@ -414,7 +1113,7 @@ const char *Anyarg::get_value_str(char letter) const
 }
 
 
-int Anyarg::get_value_int(const char *name) const
+ANYARG_INLINE int Anyarg::get_value_int(const char *name) const
 {
 	int j = get_optind(name);
 
@@ -422,7 +1121,7 @@ int Anyarg::get_value_int(const char *name) const
 		fprintf(stderr, "option --%s is undefined.\n", name);
 		exit(1);
 	}
-	if (options_[j].type != ANYARG_OPT_INT) {
+	if (options_[j].type != Option::OPT_INT) {
 		fprintf(stderr, "option --%s is not a option with an integer value.\n", name);
 		exit(1);
 	}
@@ -430,7 +1129,7 @@ int Anyarg::get_value_int(const char *name) const
 }
 
 
-int Anyarg::get_value_int(char letter) const
+ANYARG_INLINE int Anyarg::get_value_int(char letter) const
 {
 	int j = get_optind(letter);
 
@@ -439,7 +1138,7 @@ int Anyarg::get_value_int(char letter) const
 		return 0;
 	}
 	
-	if (options_[j].type != ANYARG_OPT_INT) {
+	if (options_[j].type != Option::OPT_INT) {
 		fprintf(stderr, "option -%c is not a option with an integer value.\n", letter);
 		return 0;
 	}
@@ -447,7 +1146,7 @@ int Anyarg::get_value_int(char letter) const
 }
 
 
-double Anyarg::get_value_double(const char *name) const
+ANYARG_INLINE double Anyarg::get_value_double(const char *name) const
 {
 	int j = get_optind(name);
 
@@ -455,7 +1154,7 @@ double Anyarg::get_value_double(const char *name) const
 		fprintf(stderr, "option --%s is undefined.\n", name);
 		exit(1);
 	}
-	if (options_[j].type != ANYARG_OPT_DOUBLE) {
+	if (options_[j].type != Option::OPT_DOUBLE) {
 		fprintf(stderr, "option --%s is not a option with a double value.\n", name);
 		exit(1);
 	}
@@ -463,7 +1162,7 @@ double Anyarg::get_value_double(const char *name) const
 }
 
 
-double Anyarg::get_value_double(char letter) const
+ANYARG_INLINE double Anyarg::get_value_double(char letter) const
 {
 	int j = get_optind(letter);
 
@@ -472,7 +1171,7 @@ double Anyarg::get_value_double(char letter) const
 		return 0;
 	}
 	
-	if (options_[j].type != ANYARG_OPT_DOUBLE) {
+	if (options_[j].type != Option::OPT_DOUBLE) {
 		fprintf(stderr, "option -%c is not a option with a double value.\n", letter);
 		return 0;
 	}
@@ -480,10 +1179,76 @@ double Anyarg::get_value_double(char letter) const
 }
 
 
-int Anyarg::get_argc() const {return argc_;}
+ANYARG_INLINE uint64_t Anyarg::get_value_size(const char *name) const
+{
+	int j = get_optind(name);
+
+	if (j < 0) {
+		fprintf(stderr, "option --%s is undefined.\n", name);
+		exit(1);
+	}
+	if (options_[j].type != Option::OPT_SIZE) {
+		fprintf(stderr, "option --%s is not a option with a size value.\n", name);
+		exit(1);
+	}
+	return options_[j].value_size;
+}
+
+
+ANYARG_INLINE uint64_t Anyarg::get_value_size(char letter) const
+{
+	int j = get_optind(letter);
+
+	if (j < 0) {
+		fprintf(stderr, "option -%c is undefined.\n", letter);
+		return 0;
+	}
+	
+	if (options_[j].type != Option::OPT_SIZE) {
+		fprintf(stderr, "option -%c is not a option with a size value.\n", letter);
+		return 0;
+	}
+	return options_[j].value_size;
+}
+
+
+ANYARG_INLINE int64_t Anyarg::get_value_duration(const char *name) const
+{
+	int j = get_optind(name);
+
+	if (j < 0) {
+		fprintf(stderr, "option --%s is undefined.\n", name);
+		exit(1);
+	}
+	if (options_[j].type != Option::OPT_DURATION) {
+		fprintf(stderr, "option --%s is not a option with a duration value.\n", name);
+		exit(1);
+	}
+	return options_[j].value_duration;
+}
 
 
-const char *Anyarg::get_arg(int i) const
+ANYARG_INLINE int64_t Anyarg::get_value_duration(char letter) const
+{
+	int j = get_optind(letter);
+
+	if (j < 0) {
+		fprintf(stderr, "option -%c is undefined.\n", letter);
+		return 0;
+	}
+	
+	if (options_[j].type != Option::OPT_DURATION) {
+		fprintf(stderr, "option -%c is not a option with a duration value.\n", letter);
+		return 0;
+	}
+	return options_[j].value_duration;
+}
+
+
+ANYARG_INLINE int Anyarg::get_argc() const {return argc_;}
+
+
+ANYARG_INLINE const char *Anyarg::get_arg(int i) const
 {
 	if (i < 0 || i >= argc_) {
 		fprintf(stderr, "option index is out-of-range\n");
@@ -494,11 +1259,12 @@ const char *Anyarg::get_arg(int i) const
 
 //  -S, --buffer-size=SIZE    use
 
-const char *Anyarg::auto_usage()
+ANYARG_INLINE const char *Anyarg::auto_usage()
 {
 	int nindent = 28;
 		  	  
 	help_.clear();
+	help_.reserve(options_.size() * 80); // a line per option, usually
 	help_.append("Options\n");
 
 	for (int i = 0; i < options_.size(); i++) {
@@ -542,7 +1308,269 @@ const char *Anyarg::auto_usage()
 }
 
 
-void Anyarg::show_options() const
+ANYARG_INLINE const char *Anyarg::completion_script(const char *shell)
+{
+	string prog = prog_name_.substr(prog_name_.rfind('/') + 1);
+	if (prog.empty()) prog = "prog";
+	string func = "_" + prog;  // name of the bash function
+	for (size_t i = 1; i < func.length(); i++)
+		if (!isalnum(func[i])) func[i] = '_';
+
+	script_.clear();
+	if (strcmp(shell, "bash") == 0) {
+		script_ += "# bash completion for " + prog + ", generated by Anyarg\n";
+		script_ += func + "()\n{\n";
+		script_ += "\tlocal cur=${COMP_WORDS[COMP_CWORD]} prev=${COMP_WORDS[COMP_CWORD-1]}\n";
+		script_ += "\tcase \"$prev\" in\n";
+		for (int pass = 0; pass < 3; pass++) { // options taking files, directories, other values
+			const char *action[] = {"COMPREPLY=($(compgen -f -- \"$cur\"))", "COMPREPLY=($(compgen -d -- \"$cur\"))",
+			                        "COMPREPLY=()"};
+			string words;
+			for (size_t i = 0; i < options_.size(); i++) {
+				const Option &opt = options_[i];
+				if (opt.type == Option::TYPE_FLAG || "fd"[pass] != anyarg_detail::meta_completion(opt.meta)) continue;
+				if (opt.letter) {
+					if (!words.empty()) words += "|";
+					anyarg_detail::append_quoted(words, string("-") + opt.letter, "'\\''", "");
+				}
+				if (!opt.name.empty()) {
+					if (!words.empty()) words += "|";
+					anyarg_detail::append_quoted(words, "--" + opt.name, "'\\''", "");
+				}
+			}
+			if (!words.empty()) script_ += "\t\t" + words + ") " + action[pass] + "; return;;\n";
+		}
+		script_ += "\tesac\n";
+		vector<string> words; // all options, sorted once here instead of at every Tab press
+		for (size_t i = 0; i < options_.size(); i++) {
+			if (options_[i].letter) words.push_back(string("-") + options_[i].letter);
+			if (!options_[i].name.empty()) words.push_back("--" + options_[i].name);
+		}
+		std::sort(words.begin(), words.end());
+		string list;
+		for (size_t k = 0; k < words.size(); k++) (list += k ? " " : "") += words[k];
+		script_ += "\tlocal words=";  // compgen expands the words again, hence the backslashes
+		anyarg_detail::append_quoted(script_, list, "\\'\\''", "\\\"`$|&;()<>*?[]{}~!#=%^,");
+		script_ += "\n";
+		script_ += "\tcase \"$cur\" in\n";
+		script_ += "\t\t-*) COMPREPLY=($(compgen -W \"$words\" -- \"$cur\"));;\n";
+		script_ += "\t\t*) COMPREPLY=($(compgen -f -- \"$cur\"));;\n";
+		script_ += "\tesac\n}\n";
+		script_ += "complete -F " + func + " " + prog + "\n";
+	} else if (strcmp(shell, "zsh") == 0) {
+		script_ += "#compdef " + prog + "\n";
+		script_ += "# zsh completion for " + prog + ", generated by Anyarg\n";
+		script_ += "_arguments -s \\\n";
+		for (size_t i = 0; i < options_.size(); i++) {
+			const Option &opt = options_[i];
+			bool arg = opt.type != Option::TYPE_FLAG;
+			script_ += "\t";
+			if (opt.letter && !opt.name.empty()) {
+				script_ += string("'(-") + opt.letter + " --" + opt.name + ")'{-" + opt.letter + (arg ? "+" : "");
+				script_ += ",--" + opt.name + (arg ? "=" : "") + "}";
+			} else if (opt.letter) {
+				script_ += string("-") + opt.letter + (arg ? "+" : "");
+			} else {
+				script_ += "--" + opt.name + (arg ? "=" : "");
+			}
+			string spec = "[";
+			for (size_t k = 0; k < opt.desc.length(); k++) {
+				if (strchr("[]\\", opt.desc[k])) spec.push_back('\\');
+				spec.push_back(opt.desc[k]);
+			}
+			spec += "]";
+			if (arg) {
+				spec += ":" + (opt.meta.empty() ? string("VALUE") : opt.meta) + ":";
+				char c = anyarg_detail::meta_completion(opt.meta);
+				if (c == 'f') spec += "_files";
+				else if (c == 'd') spec += "_files -/";
+			}
+			anyarg_detail::append_quoted(script_, spec, "'\\''", "");
+			script_ += " \\\n";
+		}
+		script_ += "\t'*:argument:_files'\n";
+	} else if (strcmp(shell, "fish") == 0) {
+		script_ += "# fish completion for " + prog + ", generated by Anyarg\n";
+		for (size_t i = 0; i < options_.size(); i++) {
+			const Option &opt = options_[i];
+			script_ += "complete -c " + prog;
+			if (opt.letter) script_ += string(" -s ") + opt.letter;
+			if (!opt.name.empty()) script_ += " -l " + opt.name;
+			if (opt.type != Option::TYPE_FLAG) {
+				char c = anyarg_detail::meta_completion(opt.meta);
+				if (c == 'f') script_ += " -r -F";
+				else if (c == 'd') script_ += " -x -a '(__fish_complete_directories)'";
+				else script_ += " -x";
+			}
+			script_ += " -d ";
+			anyarg_detail::append_quoted(script_, opt.desc, "\\'", "\\");
+			script_ += "\n";
+		}
+	} else return NULL;
+
+	return script_.c_str();
+}
+
+
+// Output of export_options(): either a caller's buffer, or a file descriptor behind a stack buffer
+struct Anyarg::ExportWriter
+{
+	char *buf;   // caller's buffer, may be NULL if size is 0
+	int size;    // size of buf
+	int len;     // length of the whole output so far
+	int fd;      // file descriptor to write to, -1 if writing to buf
+	char chunk[4096]; // pending output for fd
+	int nchunk;
+	bool ok;     // false if a write to fd failed
+
+	ExportWriter(char *b, int n): buf(b), size(n), len(0), fd(-1), nchunk(0), ok(true) {}
+	ExportWriter(int f): buf(NULL), size(0), len(0), fd(f), nchunk(0), ok(true) {}
+
+	// dprintf() of POSIX stdio writes the whole chunk, which never contains a NUL, without <unistd.h>
+	void flush()
+	{
+		if (nchunk && ok && dprintf(fd, "%.*s", nchunk, chunk) != nchunk) ok = false;
+		nchunk = 0;
+	}
+
+	void put(const char *s, int n)
+	{
+		if (fd < 0) {
+			if (len < size - 1) memcpy(buf + len, s, len + n < size - 1 ? n : size - 1 - len);
+			len += n;
+			return;
+		}
+		while (n > 0) {
+			int m = n < (int)sizeof(chunk) - nchunk ? n : sizeof(chunk) - nchunk;
+			memcpy(chunk + nchunk, s, m);
+			nchunk += m; s += m; n -= m;
+			if (nchunk == sizeof(chunk)) flush();
+		}
+	}
+
+	void put(const char *s) { put(s, strlen(s)); }
+	void put(char c) { put(&c, 1); }
+
+	// write s as a JSON string
+	void put_json(const char *s)
+	{
+		put('"');
+		const char *p = s;
+		for (; *p; p++) {
+			unsigned char c = *p;
+			if (c >= 0x20 && c != '"' && c != '\\') continue;
+			put(s, p - s);
+			s = p + 1;
+			char e[8];
+			if (c == '"' || c == '\\') { e[0] = '\\'; e[1] = c; e[2] = 0; }
+			else if (c == '\n') strcpy(e, "\\n");
+			else if (c == '\t') strcpy(e, "\\t");
+			else snprintf(e, sizeof(e), "\\u%04x", c);
+			put(e);
+		}
+		put(s, p - s);
+		put('"');
+	}
+
+	// write s in a key=value line, escaping backslashes and line breaks
+	void put_line(const char *s)
+	{
+		const char *p = s;
+		for (; *p; p++) {
+			if (*p != '\\' && *p != '\n' && *p != '\r') continue;
+			put(s, p - s);
+			s = p + 1;
+			put(*p == '\\' ? "\\\\" : (*p == '\n' ? "\\n" : "\\r"));
+		}
+		put(s, p - s);
+	}
+};
+
+
+ANYARG_INLINE void Anyarg::export_to(int format, ExportWriter &w) const
+{
+	if (format != ANYARG_EXPORT_JSON && format != ANYARG_EXPORT_KV) {
+		fprintf(stderr, "invalid export format\n");
+		exit(1);
+	}
+
+	char v[32];
+	if (format == ANYARG_EXPORT_JSON) {
+		w.put("{\"program\":");
+		w.put_json(prog_name_.c_str());
+		w.put(",\"options\":[");
+		for (size_t i = 0; i < options_.size(); i++) {
+			const Option &opt = options_[i];
+			w.put(i ? ",{\"name\":" : "{\"name\":");
+			if (opt.name.empty()) w.put("null");
+			else w.put_json(opt.name.c_str());
+			w.put(",\"letter\":");
+			if (opt.letter) {
+				char l[2] = {opt.letter, 0};
+				w.put_json(l);
+			} else w.put("null");
+			w.put(",\"type\":\"");
+			w.put(anyarg_detail::type_name(opt.type));
+			w.put("\",\"value\":");
+			if (opt.type == Option::OPT_STR) w.put_json(opt.value_str.c_str());
+			else if (opt.type == Option::OPT_DOUBLE && opt.value_double != opt.value_double) w.put("null"); // NaN
+			else if (opt.type == Option::OPT_DOUBLE && (opt.value_double > DBL_MAX || opt.value_double < -DBL_MAX))
+				w.put("null");
+			else w.put(anyarg_detail::format_value(opt, v, sizeof(v)));
+			w.put(is_given(i) ? ",\"source\":\"command-line\"}" : ",\"source\":\"default\"}");
+		}
+		w.put("],\"args\":[");
+		for (int i = 0; i < argc_; i++) {
+			if (i) w.put(',');
+			w.put_json(argv_[i].c_str());
+		}
+		w.put("]}\n");
+	} else {
+		w.put("program=");
+		w.put_line(prog_name_.c_str());
+		w.put('\n');
+		for (size_t i = 0; i < options_.size(); i++) {
+			const Option &opt = options_[i];
+			w.put("name=");
+			w.put(opt.name.c_str(), opt.name.length());
+			w.put(" letter=");
+			if (opt.letter) w.put(opt.letter);
+			w.put(" type=");
+			w.put(anyarg_detail::type_name(opt.type));
+			w.put(is_given(i) ? " source=command-line value=" : " source=default value=");
+			if (opt.type == Option::OPT_STR) w.put_line(opt.value_str.c_str());
+			else w.put(anyarg_detail::format_value(opt, v, sizeof(v)));
+			w.put('\n');
+		}
+		for (int i = 0; i < argc_; i++) {
+			w.put("arg=");
+			w.put_line(argv_[i].c_str());
+			w.put('\n');
+		}
+	}
+}
+
+
+ANYARG_INLINE int Anyarg::export_options(int format, char *buf, int size) const
+{
+	ExportWriter w(buf, size);
+	export_to(format, w);
+	if (size > 0) buf[w.len < size - 1 ? w.len : size - 1] = '\0';
+	return w.len;
+}
+
+
+ANYARG_INLINE bool Anyarg::export_options(int format, int fd) const
+{
+	if (fd < 0) return false;
+	ExportWriter w(fd);
+	export_to(format, w);
+	w.flush();
+	return w.ok;
+}
+
+
+ANYARG_INLINE void Anyarg::show_options() const
 {
 	printf("Options (letter, long-name, type, value, META, desc):\n");
 	for (int i = 0; i < options_.size(); i++) {
@@ -555,19 +1583,25 @@ void Anyarg::show_options() const
 		printf("%c%20s%4d", letter, name.c_str(), t.type);
 		
 		switch(t.type) {
-			case ANYARG_TYPE_FLAG:
+			case Option::TYPE_FLAG:
 				if (t.value_bool) printf("%10s", "true");
 				else printf("%10s", "false");
 				break;
-			case ANYARG_OPT_STR:
+			case Option::OPT_STR:
 				printf("%10s", t.value_str.c_str());
 				break;
-			case ANYARG_OPT_INT:
+			case Option::OPT_INT:
 				printf("%10d", t.value_int);
 				break;
-			case ANYARG_OPT_DOUBLE:
+			case Option::OPT_DOUBLE:
 				printf("%10f", t.value_double);
 				break;
+			case Option::OPT_SIZE:
+				printf("%10llu", (unsigned long long)t.value_size);
+				break;
+			case Option::OPT_DURATION:
+				printf("%10lld", (long long)t.value_duration);
+				break;
 			default:
 				printf("%10s", "NOVALUE");
 		}
@@ -21,6 +21,9 @@ Options can be given as:
 \endverbatim
 where --help, -h, -a, -b are boolean flags, option --long and -c take an argument.
 
+Like GNU getopt_long, a long option may be abbreviated to any unambiguous prefix of its name, e.g.: --buf for
+--buffer-size. An abbreviation matching more than one option is rejected with the list of candidates.
+
 Although options can mix up with non-option arguments, it is a good practice to place options before non-option
 arguments.
 
@@ -66,33 +69,75 @@ http://www.gnu.org/prep/standards/html_node/Command_002dLine-Interfaces.html
 #include <vector>
 #include <cstdlib>
 #include <cstring>
+#include <stdint.h>
 
 using std::string;
 using std::vector;
 
+// Define ANYARG_HEADER_ONLY before including anyarg.h to use Anyarg without compiling anyarg.cpp: all functions are
+// then defined inline in the header, so calls to getters can be inlined into the caller.
+#ifdef ANYARG_HEADER_ONLY
+#define ANYARG_INLINE inline
+#else
+#define ANYARG_INLINE
+#endif
+
+// formats of Anyarg::export_options()
+#define ANYARG_EXPORT_JSON 1
+#define ANYARG_EXPORT_KV   2
+
+
+// Parsers of size and duration values, in bytes and nanoseconds, shared by Anyarg and anyarg-gen
+namespace anyarg_detail {
+ANYARG_INLINE bool parse_size(const char *s, uint64_t *size);
+ANYARG_INLINE bool parse_duration(const char *s, int64_t *ns);
+}
+
 
 /// Data structure of a program option
 struct Option
 {
-	char type;    // type of option
+	enum Type { TYPE_FLAG = 1, OPT_STR, OPT_INT, OPT_DOUBLE, OPT_SIZE, OPT_DURATION };
+
+	char type;    // type of option, a Type
 	char letter;  // single-letter label of an option
 	string name;   // long name of an option
 //	char valtype;  // value type, [BSID], bool: B, string: S, int: I, double: D
 	string value_str; // option value as a string
-	union {           // option value as a bool, int or double value
+	union {           // option value as a bool, int, double, size or duration value
 		bool value_bool;
 		int  value_int;
 		double value_double;
+		uint64_t value_size;    // in bytes
+		int64_t value_duration; // in nanoseconds
 	};
 	string desc;   // a short sentence to describe an option
 	string meta;   // a META word to specify the type of option argument, such as "FILE", "SIZE"
+	bool has_range;   // whether an int or double value is limited to [range_min, range_max]
+	double range_min, range_max;
+	string choices;   // valid values of a string option separated by '|', empty if any value is valid
+	vector<string> choice_set; // hash set of valid values, with open addressing
 
-	Option():type(0), letter(), name(), value_str(), value_double(0.0), desc(), meta() {}
+	Option():type(0), letter(), name(), value_str(), value_double(0.0), desc(), meta(),
+	         has_range(false), range_min(0.0), range_max(0.0), choices(), choice_set() {}
 	bool set_value(const char *opt_value);
+	bool set_choices(const char *list);
+	bool is_choice(const char *value) const;
 	bool set_desc_meta(const char *opt_desc);
 };
 
 
+/// A statically defined option, as emitted by anyarg-gen from an option spec file.
+struct OptionSpec
+{
+	char valtype;     // value type, [BSIDZT], bool: B, string: S, int: I, double: D, size: Z, duration: T
+	char letter;      // single-letter label of an option, 0 if none
+	const char *name; // long name of an option, "" if none
+	const char *v0;   // default value as a string, NULL for flags
+	const char *desc; // description, may start with a META word as in add_option_str()
+};
+
+
 /// Use this class to define program options and parse command line arguments.
 class Anyarg
 {
@@ -136,7 +181,89 @@ class Anyarg
 	bool add_option_double(char letter, double v0, const char *desc);
 	bool add_option_double(const char *name, char letter, double v0, const char *desc);
 	//@}
+
+	//@{
+	/**
+	Add an option taking a human-readable size or duration, converted once when it is parsed.
+	@param name   Long name of an option.
+	@param letter Single-letter label of an option. Set letter to 0 if you do not need a short label.
+	@param v0     The default value, written as in command line, such as "4M" or "250ms".
+	@param desc   Description of an option, as in add_option_str(). The META word is SIZE or DURATION by default.
+	@return       \c true if success.
+	@note         A size is a count of bytes with an optional unit: K, M, G and T or KiB, MiB, GiB and TiB are powers
+	              of 1024, kB, MB, GB and TB are powers of 1000, and B is a byte, e.g.: 4096, 64K, 10MB.
+	              A duration is a sequence of counts with units, ns, us, ms, s, m (or min) and h, such as 250ms or
+	              1h30m. A count without unit is in seconds. A value overflowing 64 bits is an error.
+	*/
+	// Add an option with a size value
+	bool add_option_size(const char *name, char letter, const char *v0, const char *desc);
+	bool add_option_size(char letter, const char *v0, const char *desc);
+
+	// Add an option with a duration value
+	bool add_option_duration(const char *name, char letter, const char *v0, const char *desc);
+	bool add_option_duration(char letter, const char *v0, const char *desc);
+	//@}
+
+	/**
+	Add all options of a static option table generated by anyarg-gen.
+	@param specs   The option table. Duplicated options are rejected by anyarg-gen at build time.
+	@param n       The number of options in \c specs.
+	@param find    Perfect-hash lookup of a long name of length \c len, returns its index in \c specs or -1.
+	@param letters Index in \c specs of the option labeled by each of 256 letters, -1 if undefined.
+	@param order   Indices in \c specs of the options with a long name, sorted by name.
+	@return        \c true if success.
+	@note          The generated lookups replace the linear search of options, and the sorted order the sort of
+	               names in parse_argv(), as long as no other option is added. If options have been defined before,
+	               the table is checked and added entry by entry.
+	*/
+	bool add_options(const OptionSpec *specs, int n, int (*find)(const char *name, int len), const short *letters,
+	                 const short *order);
 	
+	//@{
+	/**
+	Limit the value of an int or double option given in command line to a range.
+	@param name   The same name used in add_option_xxx().
+	@param letter Single-letter label of an option.
+	@param lo     The minimal valid value.
+	@param hi     The maximal valid value.
+	@return       \c true if success.
+	@note         An out-of-range value stops parse_argv() with an error. Default values are not checked. A range
+	              with lo > hi is an error.
+	*/
+	bool set_range(const char *name, double lo, double hi);
+	bool set_range(char letter, double lo, double hi);
+	//@}
+
+	//@{
+	/**
+	Limit the value of a string option given in command line to a set of choices.
+	@param name    The same name used in add_option_str().
+	@param letter  Single-letter label of an option.
+	@param choices Valid values separated by '|', such as "fast|slow|auto".
+	@return        \c true if success.
+	@note          Any other value stops parse_argv() with an error. Default values are not checked.
+	*/
+	bool set_choices(const char *name, const char *choices);
+	bool set_choices(char letter, const char *choices);
+	//@}
+
+	/**
+	Forbid options to be given together in command line.
+	@param opts Options as they are written in command line, separated by spaces, such as "--all -v".
+	@return     \c true if success.
+	@note       parse_argv() stops with an error if more than one of them is given.
+	*/
+	bool add_exclusive(const char *opts);
+
+	/**
+	Require options to be given in command line together with an option.
+	@param opt  An option as it is written in command line, such as "--output" or "-o".
+	@param opts Options required by \c opt, separated by spaces, such as "--format -z".
+	@return     \c true if success.
+	@note       parse_argv() stops with an error if \c opt is given without all of them.
+	*/
+	bool add_requires(const char *opt, const char *opts);
+
 	/**
 	Parse command line arguments.
 	@pre         Flags and options have to be defined by add_flag() and add_option_xxx() before the parsing of command line.
@@ -178,6 +305,14 @@ class Anyarg
 	// Get the value of an option with double values
 	double get_value_double(const char *name) const;
 	double get_value_double(char letter) const;
+
+	// Get the value of an option with size values, in bytes
+	uint64_t get_value_size(const char *name) const;
+	uint64_t get_value_size(char letter) const;
+
+	// Get the value of an option with duration values, in nanoseconds
+	int64_t get_value_duration(const char *name) const;
+	int64_t get_value_duration(char letter) const;
 	//@}
 
 	/**
@@ -193,30 +328,101 @@ class Anyarg
 	*/
 	const char *get_arg(int i) const;
 
+	//@{
+	/**
+	Export all options and non-option arguments, e.g. to log the effective configuration of a program.
+	@param format ANYARG_EXPORT_JSON for a JSON object, or ANYARG_EXPORT_KV for lines of key=value pairs: a
+	              "program=" line, a "name= letter= type= source= value=" line per option, then an "arg=" line per
+	              non-option argument. The source of a value is either "default" or "command-line". Sizes
+	              are in bytes and durations in nanoseconds.
+	@param buf    Buffer to write the output in. The output is truncated to \c size - 1 characters and always ends
+	              with a NUL if \c size > 0, as snprintf() does. It may be NULL if \c size is 0, to get the length
+	              of the output.
+	@param size   Size of \c buf.
+	@param fd     File descriptor to write the output to.
+	@return       The length of the whole output, excluding the NUL, for a buffer; \c true if success for a file
+	              descriptor.
+	@note         The output is produced in a single pass with no memory allocation.
+	*/
+	int export_options(int format, char *buf, int size) const;
+	bool export_options(int format, int fd) const;
+	//@}
+
 	/**
 	Generate well-formatted usage information for options defined for the program.
 	@return Usage information as a c-string.
 	*/
 	const char *auto_usage();
 
+	/**
+	Generate a shell completion script for options defined for the program.
+	@param shell  Name of the shell: "bash", "zsh" or "fish".
+	@return       The script as a c-string, or \c NULL if the shell is not supported.
+	@note         Call it after parse_argv(), the completion is named after the program in command line.
+	              All scripts list the options statically, so a Tab press never runs the program.
+	*/
+	const char *completion_script(const char *shell);
+
   private:
 	string prog_name_;  // name of the program
 	int argc_;    // count of non-option arguments
 	vector<string> argv_; // vector of non-option arguments
 
 	vector<Option> options_; // vector of options
+	int (*find_name_)(const char *, int); // perfect-hash lookup of long names from add_options()
+	const short *find_letter_; // letter table from add_options()
+	const short *find_order_;  // options with a long name sorted by name, from add_options()
+	int nfind_;  // number of options covered by find_name_, find_letter_ and find_order_
+	vector<int> name_index_; // indices of options with a long name, sorted by name
+
+	vector<uint64_t> set_mask_; // bit i is set if options_[i] is given in command line
+	vector< vector<uint64_t> > exclusive_; // masks of mutually exclusive options
+	vector<int> requirer_;                 // option requiring the options in requires_ with the same index
+	vector< vector<uint64_t> > requires_;  // masks of required options
 	
 	string help_;     // formatted help for options
 
+	string script_;   // shell completion script
+
+	struct ExportWriter; // output of export_options()
+	void export_to(int format, ExportWriter &w) const;
+
 	Anyarg(const Anyarg &); // prevent the copy of a anyarg object
 
 	Anyarg & operator = (const Anyarg &); // prevent assignment of anyarg object
 	
 	bool is_new_option(const char *name, char letter);
 
+	// Set the value of options_[j] given in command line, and mark it in set_mask_
+	void set_option(int j, const char *value);
+
+	// Whether options_[j] is given in command line, otherwise it has the default value
+	bool is_given(int j) const;
+
+	// Find an option written as "--name" or "-c" in s[0..len), exit if it is undefined
+	int  token_optind(const char *s, int len) const;
+
+	// Build the mask of options listed in opts, separated by spaces
+	void make_mask(const char *opts, vector<uint64_t> &mask) const;
+
+	// Check exclusive and required options against set_mask_
+	void check_groups() const;
+
 	int  get_optind(char letter) const;
 
 	int  get_optind(const char *name) const;
+
+	// Sort long names for abbreviation matching, done once after all options are defined
+	void build_name_index();
+
+	// Find the range [first, last) of name_index_ whose long names start with name[0..len)
+	void prefix_range(const char *name, int len, int &first, int &last) const;
+
+	// Find the option whose long name is name[0..len) or starts with it, exit if it is ambiguous
+	int  match_optind(const char *name, int len) const;
+
+	// Print the long names closest to an unknown option name[0..len) to stderr
+	void suggest_options(const char *name, int len);
 	
 	// Show information of all options, for debugging.
 	void show_options() const;
@@ -255,4 +461,8 @@ int main(int argc, char **argv)
 \endcode
 */
 
+#ifdef ANYARG_HEADER_ONLY
+#include "anyarg.cpp"
+#endif
+
 #endif
@@ -0,0 +1,366 @@
+/*
+anyarg-gen compiles an option spec file into a C++ header, which defines the options of a program by one call of
+Anyarg::add_options() instead of a series of add_flag() and add_option_xxx() calls.
+
+Usage: anyarg-gen foo.spec foo_opts.h
+
+Each line of a spec file defines an option, in the same order as the arguments of add_flag() and add_option_xxx():
+\verbatim
+# type   name         letter  default  description
+flag     all          a                List all stuffs.
+str      input-file   i       -        =FILE Input filename, default is -.
+int      buffer-size  b       100      =SIZE Set the buffer size, default is 100.
+double   min          -       0.9      =FLOAT Minimal correlation coefficient, default is 0.9.
+size     cache        -       64M      Size of the cache.
+duration timeout      t       250ms    Timeout of a request.
+\endverbatim
+A - in place of a name or a letter means the option has none. Flags take no default value. A default value
+containing spaces can be double-quoted. Empty lines and lines starting with # are ignored. Default values are
+checked by the parsers of Anyarg itself, as anyarg-gen links anyarg.o, so an invalid one fails the build.
+
+The generated header, prefixed by the name of the spec file (foo_ for foo.spec), contains:
+- a static OptionSpec table;
+- a perfect hash of the long names: a hash of a name picks a bucket, the seed of this bucket picks the slot of the name;
+- a table from each letter to its option;
+- the options with a long name in name order, so that parse_argv() needs no sort for abbreviations;
+- foo_add_options(Anyarg &) to define all options, and one typed accessor for each option, e.g.: foo_buffer_size().
+
+All of them are static, so that each file including the header has its own copy.
+
+Duplicated options are reported as errors, so they never reach a program.
+*/
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <cctype>
+#include <cerrno>
+#include <climits>
+#include <stdint.h>
+#include "anyarg.h"
+
+using std::string;
+using std::vector;
+
+
+// An option read from a spec file
+struct SpecEntry
+{
+	char valtype;  // value type, [BSIDZT]
+	char letter;   // 0 if none
+	string name;   // "" if none
+	string v0;     // default value
+	string desc;
+	string ident;  // name of the accessor, without prefix
+};
+
+
+// Hash functions shared with the generated code, which repeats them verbatim
+static uint32_t hash_name(const char *s, int len)
+{
+	uint32_t h = 2166136261u; // FNV-1a
+	for (int i = 0; i < len; i++) h = (h ^ (unsigned char)s[i]) * 16777619u;
+	return h;
+}
+
+
+static uint32_t hash_mix(uint32_t h)
+{
+	h ^= h >> 16; h *= 0x85ebca6bu;
+	h ^= h >> 13; h *= 0xc2b2ae35u;
+	h ^= h >> 16;
+	return h;
+}
+
+
+static void die(const char *spec, int line, const char *msg, const string &what)
+{
+	fprintf(stderr, "%s line %d: %s%s\n", spec, line, msg, what.c_str());
+	exit(1);
+}
+
+
+// Read the next field of a line, a double-quoted field may contain spaces
+static string next_field(const string &line, size_t &i, bool quoted)
+{
+	while (i < line.length() && isspace(line[i])) ++i;
+	size_t start = i;
+	if (quoted && i < line.length() && line[i] == '"') {
+		size_t end = line.find('"', i + 1);
+		if (end == string::npos) end = line.length();
+		i = end < line.length() ? end + 1 : end;
+		return line.substr(start + 1, end - start - 1);
+	}
+	while (i < line.length() && !isspace(line[i])) ++i;
+	return line.substr(start, i - start);
+}
+
+
+static vector<SpecEntry> read_spec(const char *fn)
+{
+	FILE *fp = fopen(fn, "r");
+	if (fp == NULL) {
+		fprintf(stderr, "can not open %s\n", fn);
+		exit(1);
+	}
+
+	vector<SpecEntry> specs;
+	string line;
+	int lineno = 0;
+	for (int c = fgetc(fp); c != EOF; ) {
+		line.clear();
+		while (c != EOF && c != '\n') { line.push_back(c); c = fgetc(fp); }
+		if (c == '\n') c = fgetc(fp);
+		lineno++;
+
+		size_t i = 0;
+		string type = next_field(line, i, false);
+		if (type.empty() || type[0] == '#') continue;
+
+		SpecEntry e;
+		if (type == "flag") e.valtype = 'B';
+		else if (type == "str") e.valtype = 'S';
+		else if (type == "int") e.valtype = 'I';
+		else if (type == "double") e.valtype = 'D';
+		else if (type == "size") e.valtype = 'Z';
+		else if (type == "duration") e.valtype = 'T';
+		else die(fn, lineno, "unknown option type ", type);
+
+		e.name = next_field(line, i, false);
+		if (e.name.empty()) die(fn, lineno, "option name is missed", "");
+		if (e.name == "-") e.name = "";
+
+		string letter = next_field(line, i, false);
+		if (letter.length() != 1) die(fn, lineno, "invalid option letter ", letter);
+		e.letter = letter == "-" ? 0 : letter[0];
+		if (e.name.empty() && e.letter == 0) die(fn, lineno, "invalid option", "");
+
+		if (e.valtype != 'B') {
+			if (i >= line.length()) die(fn, lineno, "default value is missed", "");
+			e.v0 = next_field(line, i, true);
+			char *end;
+			uint64_t size;
+			int64_t ns;
+			long v = 0;
+			errno = 0;
+			if (e.valtype == 'I') v = strtol(e.v0.c_str(), &end, 10);
+			if (e.valtype == 'D') strtod(e.v0.c_str(), &end);
+			if ((e.valtype == 'I' || e.valtype == 'D') && (e.v0.empty() || *end))
+				die(fn, lineno, "invalid default value ", e.v0);
+			if (e.valtype == 'I' && (errno == ERANGE || v < INT_MIN || v > INT_MAX))
+				die(fn, lineno, "default value out of the range of int ", e.v0);
+			if (e.valtype == 'Z' && !anyarg_detail::parse_size(e.v0.c_str(), &size)) die(fn, lineno, "invalid default size ", e.v0);
+			if (e.valtype == 'T' && !anyarg_detail::parse_duration(e.v0.c_str(), &ns))
+				die(fn, lineno, "invalid default duration ", e.v0);
+		}
+
+		while (i < line.length() && isspace(line[i])) ++i;
+		e.desc = line.substr(i);
+
+		e.ident = e.name.empty() ? letter : e.name;
+		for (size_t k = 0; k < e.ident.length(); k++)
+			if (!isalnum(e.ident[k])) e.ident[k] = '_';
+
+		for (size_t k = 0; k < specs.size(); k++) {
+			if (!e.name.empty() && specs[k].name == e.name) die(fn, lineno, "option has been defined: --", e.name);
+			if (e.letter && specs[k].letter == e.letter) die(fn, lineno, "option has been defined: -", letter);
+			if (specs[k].ident == e.ident) die(fn, lineno, "accessor name has been used: ", e.ident);
+		}
+		specs.push_back(e);
+	}
+	fclose(fp);
+	return specs;
+}
+
+
+// Place each name of a bucket by trying seeds until all of them land in free slots. Buckets are placed from the
+// largest, while most slots are still free.
+static bool perfect_hash(const vector<SpecEntry> &specs, vector<uint32_t> &seeds, vector<int> &slots)
+{
+	vector< vector<int> > buckets(seeds.size());
+	for (size_t i = 0; i < specs.size(); i++) {
+		if (specs[i].name.empty()) continue;
+		uint32_t h = hash_name(specs[i].name.c_str(), specs[i].name.length());
+		buckets[h % seeds.size()].push_back(i);
+	}
+
+	vector<int> order(buckets.size());
+	for (size_t b = 0; b < order.size(); b++) order[b] = b;
+	for (size_t b = 1; b < order.size(); b++) // insertion sort by bucket size, descending
+		for (size_t k = b; k > 0 && buckets[order[k]].size() > buckets[order[k - 1]].size(); k--)
+			std::swap(order[k], order[k - 1]);
+
+	vector<int> tried;
+	for (size_t b = 0; b < order.size(); b++) {
+		const vector<int> &bucket = buckets[order[b]];
+		if (bucket.empty()) break;
+		uint32_t seed = 1;
+		for (; seed < (1u << 24); seed++) {
+			tried.clear();
+			for (size_t k = 0; k < bucket.size(); k++) {
+				const string &name = specs[bucket[k]].name;
+				uint32_t s = hash_mix(hash_name(name.c_str(), name.length()) ^ seed) % slots.size();
+				if (slots[s] >= 0 || std::find(tried.begin(), tried.end(), (int)s) != tried.end()) break;
+				tried.push_back(s);
+			}
+			if (tried.size() == bucket.size()) break;
+		}
+		if (seed == (1u << 24)) return false;
+		seeds[order[b]] = seed;
+		for (size_t k = 0; k < bucket.size(); k++) slots[tried[k]] = bucket[k];
+	}
+	return true;
+}
+
+
+// Order spec indices by long name, as Anyarg sorts its name index
+struct SpecNameLess
+{
+	const vector<SpecEntry> &specs;
+	SpecNameLess(const vector<SpecEntry> &s): specs(s) {}
+	bool operator()(int a, int b) const { return specs[a].name < specs[b].name; }
+};
+
+
+// Write s as a C string literal
+static void put_literal(FILE *fp, const string &s)
+{
+	fputc('"', fp);
+	for (size_t i = 0; i < s.length(); i++) {
+		unsigned char c = s[i];
+		if (c == '"' || c == '\\') fprintf(fp, "\\%c", c);
+		else if (isprint(c)) fputc(c, fp);
+		else fprintf(fp, "\\%03o", c);
+	}
+	fputc('"', fp);
+}
+
+
+// Write c as a C character literal, 0 for none
+static void put_letter(FILE *fp, char c)
+{
+	if (c == 0) fprintf(fp, "0");
+	else if (c == '\'' || c == '\\') fprintf(fp, "'\\%c'", c);
+	else fprintf(fp, "'%c'", c);
+}
+
+
+int main(int argc, char **argv)
+{
+	if (argc != 3) {
+		fprintf(stderr, "Usage: %s foo.spec foo_opts.h\n", argv[0]);
+		return 1;
+	}
+
+	vector<SpecEntry> specs = read_spec(argv[1]);
+	int n = specs.size();
+
+	// prefix of generated names, from the name of the spec file
+	string prefix = argv[1];
+	prefix = prefix.substr(prefix.rfind('/') + 1);
+	prefix = prefix.substr(0, prefix.find('.'));
+	for (size_t k = 0; k < prefix.length(); k++)
+		if (!isalnum(prefix[k])) prefix[k] = '_';
+	if (prefix.empty() || isdigit(prefix[0])) prefix = "opt" + prefix;
+	string guard = prefix + "_OPTS_H";
+	for (size_t k = 0; k < guard.length(); k++) guard[k] = toupper(guard[k]);
+
+	vector<uint32_t> seeds(n / 4 + 1, 0);
+	vector<int> slots(n + n / 4 + 1, -1);
+	if (!perfect_hash(specs, seeds, slots)) {
+		fprintf(stderr, "%s: can not find a perfect hash of option names\n", argv[1]);
+		return 1;
+	}
+
+	FILE *fp = fopen(argv[2], "w");
+	if (fp == NULL) {
+		fprintf(stderr, "can not open %s\n", argv[2]);
+		return 1;
+	}
+	const char *p = prefix.c_str();
+
+	fprintf(fp, "// Generated by anyarg-gen from %s, do not edit.\n\n", argv[1]);
+	fprintf(fp, "#ifndef %s\n#define %s\n\n", guard.c_str(), guard.c_str());
+	fprintf(fp, "#include <cstring>\n#include <stdint.h>\n#include \"anyarg.h\"\n\n");
+
+	fprintf(fp, "static const OptionSpec %s_specs[%d] = {\n", p, n ? n : 1);
+	for (int i = 0; i < n; i++) {
+		const SpecEntry &e = specs[i];
+		fprintf(fp, "\t{'%c', ", e.valtype);
+		put_letter(fp, e.letter);
+		fprintf(fp, ", ");
+		put_literal(fp, e.name);
+		fprintf(fp, ", ");
+		if (e.valtype == 'B') fprintf(fp, "NULL");
+		else put_literal(fp, e.v0);
+		fprintf(fp, ", ");
+		put_literal(fp, e.desc);
+		fprintf(fp, "},\n");
+	}
+	if (n == 0) fprintf(fp, "\t{0, 0, \"\", NULL, \"\"}\n");
+	fprintf(fp, "};\n\n");
+
+	fprintf(fp, "static const uint32_t %s_seeds[%d] = {", p, (int)seeds.size());
+	for (size_t k = 0; k < seeds.size(); k++) fprintf(fp, "%s%u", k % 8 ? ", " : (k ? ",\n\t" : "\n\t"), seeds[k]);
+	fprintf(fp, "\n};\n\n");
+
+	fprintf(fp, "static const short %s_slots[%d] = {", p, (int)slots.size());
+	for (size_t k = 0; k < slots.size(); k++) fprintf(fp, "%s%d", k % 16 ? ", " : (k ? ",\n\t" : "\n\t"), slots[k]);
+	fprintf(fp, "\n};\n\n");
+
+	int letters[256];
+	for (int c = 0; c < 256; c++) letters[c] = -1;
+	for (int i = 0; i < n; i++)
+		if (specs[i].letter) letters[(unsigned char)specs[i].letter] = i;
+	fprintf(fp, "static const short %s_letters[256] = {", p);
+	for (int c = 0; c < 256; c++) fprintf(fp, "%s%d", c % 16 ? ", " : (c ? ",\n\t" : "\n\t"), letters[c]);
+	fprintf(fp, "\n};\n\n");
+
+	vector<int> order;
+	for (int i = 0; i < n; i++)
+		if (!specs[i].name.empty()) order.push_back(i);
+	std::sort(order.begin(), order.end(), SpecNameLess(specs));
+	fprintf(fp, "static const short %s_order[%d] = {", p, order.empty() ? 1 : (int)order.size());
+	for (size_t k = 0; k < order.size(); k++) fprintf(fp, "%s%d", k % 16 ? ", " : (k ? ",\n\t" : "\n\t"), order[k]);
+	if (order.empty()) fprintf(fp, "\n\t-1");
+	fprintf(fp, "\n};\n\n");
+
+	fprintf(fp, "static inline int %s_find_name(const char *name, int len)\n{\n", p);
+	fprintf(fp, "\tuint32_t h = 2166136261u;\n");
+	fprintf(fp, "\tfor (int i = 0; i < len; i++) h = (h ^ (unsigned char)name[i]) * 16777619u;\n");
+	fprintf(fp, "\tuint32_t s = %s_seeds[h %% %du];\n", p, (int)seeds.size());
+	fprintf(fp, "\tif (s == 0) return -1;\n");
+	fprintf(fp, "\th ^= s;\n");
+	fprintf(fp, "\th ^= h >> 16; h *= 0x85ebca6bu;\n");
+	fprintf(fp, "\th ^= h >> 13; h *= 0xc2b2ae35u;\n");
+	fprintf(fp, "\th ^= h >> 16;\n");
+	fprintf(fp, "\tint j = %s_slots[h %% %du];\n", p, (int)slots.size());
+	fprintf(fp, "\tif (j < 0 || strncmp(%s_specs[j].name, name, len) != 0 || %s_specs[j].name[len] != 0) return -1;\n",
+	        p, p);
+	fprintf(fp, "\treturn j;\n}\n\n");
+
+	fprintf(fp, "static inline bool %s_add_options(Anyarg &opt)\n{\n", p);
+	fprintf(fp, "\treturn opt.add_options(%s_specs, %d, %s_find_name, %s_letters, %s_order);\n}\n\n", p, n, p, p, p);
+
+	for (int i = 0; i < n; i++) {
+		const SpecEntry &e = specs[i];
+		const char *type = "bool", *getter = "is_true";
+		if (e.valtype == 'S') { type = "const char *"; getter = "get_value_str"; }
+		if (e.valtype == 'I') { type = "int "; getter = "get_value_int"; }
+		if (e.valtype == 'D') { type = "double "; getter = "get_value_double"; }
+		if (e.valtype == 'Z') { type = "uint64_t "; getter = "get_value_size"; }
+		if (e.valtype == 'T') { type = "int64_t "; getter = "get_value_duration"; }
+		fprintf(fp, "static inline %s%s%s_%s(const Anyarg &opt) { return opt.%s(", type, e.valtype == 'B' ? " " : "",
+		        p, e.ident.c_str(), getter);
+		if (e.name.empty()) put_letter(fp, e.letter);
+		else put_literal(fp, e.name);
+		fprintf(fp, "); }\n");
+	}
+
+	fprintf(fp, "\n#endif\n");
+	fclose(fp);
+	return 0;
+}
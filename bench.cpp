@@ -0,0 +1,301 @@
+/*
+Micro benchmarks of Anyarg on large option schemas. Build and run them by: make bench
+*/
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <time.h>
+#include "anyarg.h"
+
+using std::string;
+using std::vector;
+
+
+// Wall clock time in seconds
+static double now()
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+
+// Long names of a large schema, sharing long prefixes as real option names do
+static vector<string> make_names(int n)
+{
+	vector<string> names;
+	char s[64];
+	for (int i = 0; i < n; i++) {
+		snprintf(s, sizeof(s), "group%02d-option-%04d", i % 37, i);
+		names.push_back(s);
+	}
+	return names;
+}
+
+
+// Resolving long options in parse_argv() against the linear scan get_optind() did before abbreviations: every
+// lookup compared the name with each option in turn.
+static void bench_lookup()
+{
+	const int nopt = 2000, nq = 200000;
+	vector<string> names = make_names(nopt);
+
+	Anyarg opt;
+	for (int i = 0; i < nopt; i++) opt.add_flag(names[i].c_str(), 0, "");
+
+	vector<string> args;
+	vector<char *> argv;
+	args.push_back("bench");
+	for (int i = 0; i < nq; i++) {
+		const string &s = names[(i * 7919) % nopt];
+		args.push_back("--" + (i % 2 ? s : s.substr(0, s.length() - 1))); // half of them abbreviated
+	}
+	for (size_t i = 0; i < args.size(); i++) argv.push_back(&args[i][0]);
+
+	double t0 = now();
+	int found = 0;
+	for (int i = 1; i <= nq; i++) { // the old lookup, exact names only
+		const char *name = names[(i * 7919) % nopt].c_str();
+		for (int j = 0; j < nopt; j++)
+			if (names[j] == name) { found++; break; }
+	}
+	double t1 = now();
+	opt.parse_argv(argv.size(), &argv[0]);
+	double t2 = now();
+
+	printf("long option lookup, %d options, %d lookups (%d found by the scan):\n", nopt, nq, found);
+	printf("  linear scan          %8.1f ns/lookup\n", (t1 - t0) / nq * 1e9);
+	printf("  parse_argv, sorted   %8.1f ns/lookup, including the sort of names\n", (t2 - t1) / nq * 1e9);
+}
+
+
+// Parsing a million command line tokens: long options with values, bundled letters and plain arguments. The scalar
+// scan for '=' alone, which find_eq() does with SSE2, is timed as a reference.
+// A command line of ntok tokens: long options with values, short flags and plain arguments
+static void make_tokens(const vector<string> &names, int ntok, vector<string> &args, vector<char *> &argv)
+{
+	args.push_back("bench");
+	for (int i = 0; i < ntok; i++) {
+		char s[64];
+		if (i % 4 == 3) snprintf(s, sizeof(s), "%s", i % 8 == 3 ? "-ab" : "input.txt");
+		else snprintf(s, sizeof(s), "--%s=%d", names[i % names.size()].c_str(), i);
+		args.push_back(s);
+	}
+	for (size_t i = 0; i < args.size(); i++) argv.push_back(&args[i][0]);
+}
+
+
+static void bench_tokens()
+{
+	const int nopt = 50, ntok = 1000000;
+	vector<string> names = make_names(nopt);
+
+	Anyarg opt;
+	for (int i = 0; i < nopt; i++) opt.add_option_int(names[i].c_str(), 0, 0, "");
+	opt.add_flag('a', "");
+	opt.add_flag('b', "");
+
+	vector<string> args;
+	vector<char *> argv;
+	make_tokens(names, ntok, args, argv);
+
+	double t0 = now();
+	size_t len = 0;
+	for (int i = 1; i <= ntok; i++) {
+		const char *p = argv[i];
+		while (*p && *p != '=') ++p;
+		len += p - argv[i];
+	}
+	double t1 = now();
+	opt.parse_argv(argv.size(), &argv[0]);
+	double t2 = now();
+
+	printf("command line of %d tokens (%lu bytes before '='):\n", ntok, (unsigned long)len);
+	printf("  scalar scan for '='  %8.1f ns/token\n", (t1 - t0) / ntok * 1e9);
+	printf("  parse_argv           %8.1f ns/token\n", (t2 - t1) / ntok * 1e9);
+}
+
+
+#ifdef ANYARG_HEADER_ONLY
+// find_eq() alone on the same million tokens. make bench runs this section twice, header-only with SSE2 and with
+// ANYARG_NO_SIMD, so that both versions of find_eq() are timed on the same input.
+static void bench_find_eq()
+{
+	const int nopt = 50, ntok = 1000000, nrep = 10;
+	vector<string> args;
+	vector<char *> argv;
+	make_tokens(make_names(nopt), ntok, args, argv);
+
+	double t0 = now();
+	size_t len = 0;
+	for (int r = 0; r < nrep; r++)
+		for (int i = 1; i <= ntok; i++)
+			len += anyarg_detail::find_eq(argv[i]) - argv[i];
+	double t1 = now();
+
+#ifdef ANYARG_SSE2
+	const char *how = "SSE2";
+#else
+	const char *how = "scalar";
+#endif
+	printf("find_eq, %s, on %d tokens (%lu bytes before '='):\n", how, ntok, (unsigned long)(len / nrep));
+	printf("  find_eq              %8.1f ns/token\n", (t1 - t0) / nrep / ntok * 1e9);
+}
+#endif
+
+
+// Exporting a 1,000-option configuration, against what a program did before export_options(): read each option
+// by its getter and format it by snprintf().
+static void bench_export()
+{
+	const int nopt = 1000, nrep = 1000;
+	vector<string> names = make_names(nopt);
+
+	Anyarg opt;
+	for (int i = 0; i < nopt; i++) {
+		if (i % 3 == 0) opt.add_option_int(names[i].c_str(), 0, i, "");
+		else if (i % 3 == 1) opt.add_option_double(names[i].c_str(), 0, i * 0.5, "");
+		else opt.add_option_str(names[i].c_str(), 0, "some/path/to/a/file.txt", "");
+	}
+	char prog[] = "bench";
+	char *argv[] = {prog};
+	opt.parse_argv(1, argv);
+
+	int size = std::max(opt.export_options(ANYARG_EXPORT_KV, NULL, 0), opt.export_options(ANYARG_EXPORT_JSON, NULL, 0));
+	vector<char> buf(size + 1);
+	double t0 = now();
+	size_t len = 0;
+	for (int r = 0; r < nrep; r++) {
+		string out;
+		char line[256];
+		for (int i = 0; i < nopt; i++) {
+			const char *name = names[i].c_str();
+			if (i % 3 == 0) snprintf(line, sizeof(line), "name=%s value=%d\n", name, opt.get_value_int(name));
+			else if (i % 3 == 1) snprintf(line, sizeof(line), "name=%s value=%.17g\n", name, opt.get_value_double(name));
+			else snprintf(line, sizeof(line), "name=%s value=%s\n", name, opt.get_value_str(name));
+			out += line;
+		}
+		len += out.length();
+	}
+	double t1 = now();
+	for (int r = 0; r < nrep; r++) len += opt.export_options(ANYARG_EXPORT_KV, &buf[0], buf.size());
+	double t2 = now();
+	for (int r = 0; r < nrep; r++) len += opt.export_options(ANYARG_EXPORT_JSON, &buf[0], buf.size());
+	double t3 = now();
+
+	printf("export of %d options (%lu bytes in all):\n", nopt, (unsigned long)len);
+	printf("  getters and snprintf %8.1f us/export\n", (t1 - t0) / nrep * 1e6);
+	printf("  export_options, kv   %8.1f us/export\n", (t2 - t1) / nrep * 1e6);
+	printf("  export_options, json %8.1f us/export\n", (t3 - t2) / nrep * 1e6);
+}
+
+
+#ifdef ANYARG_HEADER_ONLY
+// Suggestions for unknown options among 2,000 long names: a full Levenshtein distance to every name, against the
+// length filter and the banded, early-exit distance of the "did you mean" message
+static void bench_suggest()
+{
+	const int nopt = 2000, nq = 1000, nbest = 3;
+	vector<string> names = make_names(nopt);
+	std::sort(names.begin(), names.end());
+	vector<Option> opts(nopt);
+	vector<int> index(nopt);
+	for (int i = 0; i < nopt; i++) {
+		opts[i].name = names[i];
+		index[i] = i;
+	}
+	vector<string> queries;
+	for (int i = 0; i < nq; i++) { // half are typos of a name, half are far from all
+		string q = names[i * 7 % nopt];
+		if (i & 1) std::swap(q[3], q[4]);
+		else q = "no-such-option-" + q.substr(q.length() - 4);
+		queries.push_back(q);
+	}
+
+	vector<int> row;
+	int best[nbest];
+	long nfull = 0, nnear = 0;
+	double t0 = now();
+	for (int i = 0; i < nq; i++) {
+		const string &q = queries[i];
+		int tol = q.length() > 3 ? 2 : 1;
+		for (int k = 0; k < nopt; k++)
+			nfull += anyarg_detail::edit_distance(q.c_str(), q.length(), names[k].c_str(), names[k].length(),
+			                                      q.length() + names[k].length(), row) <= tol;
+	}
+	double t1 = now();
+	for (int i = 0; i < nq; i++) {
+		const string &q = queries[i];
+		nnear += anyarg_detail::nearest_names(q.c_str(), q.length(), q.length() > 3 ? 2 : 1, opts, index, best,
+		                                      nbest, row);
+	}
+	double t2 = now();
+
+	printf("suggestions among %d options, %d queries (%ld and %ld names within reach):\n", nopt, nq, nfull, nnear);
+	printf("  full distance scan   %8.1f us/query\n", (t1 - t0) / nq * 1e6);
+	printf("  nearest_names        %8.1f us/query\n", (t2 - t1) / nq * 1e6);
+}
+#endif
+
+
+// Getters on a small schema. make bench runs this section twice: calling anyarg.o, and with ANYARG_HEADER_ONLY where
+// the getters can be inlined.
+static void bench_getters()
+{
+	const int n = 10000000;
+	Anyarg opt;
+	opt.add_flag("all", 'a', "");
+	opt.add_flag("verbose", 'v', "");
+	opt.add_option_str("output", 'o', "-", "");
+	opt.add_option_int("count", 'c', 1, "");
+	opt.add_option_int("jobs", 'j', 4, "");
+	char prog[] = "bench", a[] = "-a", c[] = "--count=3";
+	char *argv[] = {prog, a, c};
+	opt.parse_argv(3, argv);
+
+	const char *names[] = {"count", "jobs"};
+	const char letters[] = {'a', 'v'};
+	double t0 = now();
+	long sum = 0;
+	for (int i = 0; i < n; i++) sum += opt.is_true(letters[i & 1]);
+	double t1 = now();
+	for (int i = 0; i < n; i++) sum += opt.get_value_int(names[i & 1]);
+	double t2 = now();
+
+#ifdef ANYARG_HEADER_ONLY
+	const char *how = "header-only, inlined";
+#else
+	const char *how = "anyarg.o, not inlined";
+#endif
+	printf("getters, %s (sum %ld):\n", how, sum);
+	printf("  is_true(letter)      %8.2f ns/call\n", (t1 - t0) / n * 1e9);
+	printf("  get_value_int(name)  %8.2f ns/call\n", (t2 - t1) / n * 1e9);
+}
+
+
+int main(int argc, char **argv)
+{
+	if (argc > 1 && strcmp(argv[1], "getters") == 0) {
+		bench_getters();
+		return 0;
+	}
+#ifdef ANYARG_HEADER_ONLY
+	if (argc > 1 && strcmp(argv[1], "find_eq") == 0) {
+		bench_find_eq();
+		return 0;
+	}
+	if (argc > 1 && strcmp(argv[1], "suggest") == 0) {
+		bench_suggest();
+		return 0;
+	}
+#endif
+	bench_lookup();
+	bench_tokens();
+	bench_export();
+	bench_getters();
+	return 0;
+}
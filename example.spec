@@ -0,0 +1,8 @@
+# Options of the example program, see anyarg_gen.cpp for the format of spec files.
+# type   name         letter  default  description
+flag     all          a                List all stuffs.
+str      input-file   i       -        =FILE Input filename, default is -.
+int      buffer-size  b       100      =SIZE Set the buffer size, default is 100.
+double   min          -       0.9      =FLOAT Minimal correlation coefficient, default is 0.9.
+flag     -            v                Open verbose model.
+flag     help         h                Display help information.
@@ -0,0 +1,30 @@
+#include <cstdio>
+#include "example_opts.h"
+
+// The example program again, with the options compiled from example.spec by: make example_opts.h
+int main(int argc, char **argv)
+{
+	// define all options of example.spec at once
+	Anyarg opt;
+	example_add_options(opt);
+
+	// parsing command line, collect command line arguments
+	opt.parse_argv(argc, argv);
+
+	// generate formatted usage information for all options
+	if (example_help(opt)) {
+		printf("%s\n", opt.auto_usage());
+		exit(0);
+	}
+
+	// access option values by the generated accessors
+	if (example_all(opt))
+		printf("option --all is set in the command line\n");
+	if (example_v(opt))
+		printf("verbose mode is opened\n");
+	printf("The value of option -b is %d\n", example_buffer_size(opt));
+	printf("The value of option --min is %f\n", example_min(opt));
+
+	// ...
+	return 1;
+}
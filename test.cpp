@@ -0,0 +1,475 @@
+/*
+Tests of Anyarg: golden checks of parsing edge cases and allocation budgets. Build and run them by: make test
+Global operator new and malloc() are replaced by counting hooks, and exceeding a budget fails the test, so that
+a change adding allocations to registration, parsing, the getters or auto_usage() is caught.
+*/
+
+#include <string>
+#include <vector>
+#include <new>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "anyarg.h"
+#include "example_opts.h"
+
+using std::string;
+using std::vector;
+
+
+// Number of allocations so far, by operator new and malloc()
+static long n_alloc = 0;
+
+// malloc() is hooked on glibc, except under AddressSanitizer which replaces it already
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__)
+#define HOOK_MALLOC
+#endif
+
+#ifdef HOOK_MALLOC
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *malloc(size_t size)
+{
+	n_alloc++;
+	return __libc_malloc(size);
+}
+#endif
+
+void *operator new(size_t size)
+{
+#ifndef HOOK_MALLOC
+	n_alloc++; // otherwise counted by malloc()
+#endif
+	void *p = std::malloc(size ? size : 1);
+	if (p == NULL) throw std::bad_alloc();
+	return p;
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+// Not inlined, or GCC reports the free() of a pointer from the replaced operator new as a mismatch
+__attribute__((noinline)) void operator delete(void *p) throw() { std::free(p); }
+__attribute__((noinline)) void operator delete[](void *p) throw() { std::free(p); }
+__attribute__((noinline)) void operator delete(void *p, size_t) throw() { std::free(p); }
+__attribute__((noinline)) void operator delete[](void *p, size_t) throw() { std::free(p); }
+
+
+static int n_fail = 0;
+
+static void check(bool ok, const char *what)
+{
+	if (!ok) {
+		fprintf(stderr, "FAIL: %s\n", what);
+		n_fail++;
+	}
+}
+
+static void check_str(const char *got, const char *expected, const char *what)
+{
+	if (got == NULL || strcmp(got, expected) != 0) {
+		fprintf(stderr, "FAIL: %s: got \"%s\", expected \"%s\"\n", what, got ? got : "(null)", expected);
+		n_fail++;
+	}
+}
+
+// Check the allocations made since n0 against a budget
+static void check_allocs(long n0, long budget, const char *what)
+{
+	long n = n_alloc - n0;
+	printf("  %-44s %6ld allocations, budget %ld\n", what, n, budget);
+	if (n > budget) {
+		fprintf(stderr, "FAIL: %s made %ld allocations, over the budget of %ld\n", what, n, budget);
+		n_fail++;
+	}
+}
+
+
+// A writable copy of a command line given as a NULL-terminated list, built before allocations are counted
+struct Argv {
+	vector<string> strs;
+	vector<char *> argv;
+	Argv(const char **args)
+	{
+		for (int i = 0; args[i]; i++) strs.push_back(args[i]);
+		for (size_t i = 0; i < strs.size(); i++) argv.push_back(&strs[i][0]);
+	}
+	bool parse(Anyarg &opt) { return opt.parse_argv(argv.size(), &argv[0]); }
+};
+
+static bool parse(Anyarg &opt, const char **args)
+{
+	Argv a(args);
+	return a.parse(opt);
+}
+
+static void define_small(Anyarg &opt)
+{
+	opt.add_flag("all", 'a', "List all stuffs.");
+	opt.add_flag('b', "Brief output.");
+	opt.add_flag("verbose", 'v', "Verbose output.");
+	opt.add_option_str("output", 'o', "-", "=FILE Output file.");
+	opt.add_option_str("name", 0, "none", "=STR Name.");
+	opt.add_option_int("count", 'c', 1, "=INT Count.");
+	opt.add_option_double("ratio", 'r', 0.5, "=FLOAT Ratio.");
+}
+
+
+// Golden checks of the parsing edge cases
+static void test_parsing()
+{
+	{
+		Anyarg opt;
+		define_small(opt);
+		const char *args[] = {"prog", "-ab", "-ofoo", "--name=value", "-", "x", "--", "-v", "--count=3", NULL};
+		check(parse(opt, args), "parse a command line with edge cases");
+		check(opt.is_true('a') && opt.is_true('b'), "bundled flags -ab set -a and -b");
+		check_str(opt.get_value_str('o'), "foo", "-ofoo is -o with the value foo");
+		check_str(opt.get_value_str("name"), "value", "--name=value");
+		check(!opt.is_true('v'), "-v after -- is not an option");
+		check(opt.get_value_int("count") == 1, "--count=3 after -- is not an option");
+		check(opt.get_argc() == 4, "non-option arguments: -, x and the two after --");
+		if (opt.get_argc() == 4) {
+			check_str(opt.get_arg(0), "-", "- is an ordinary argument");
+			check_str(opt.get_arg(1), "x", "argument before --");
+			check_str(opt.get_arg(2), "-v", "first argument after --");
+			check_str(opt.get_arg(3), "--count=3", "second argument after --");
+		}
+	}
+	{
+		Anyarg opt;
+		define_small(opt);
+		const char *args[] = {"prog", "-o", "bar", "--count", "7", "--ratio=0.25", "-va", "-c2", "--name=a=b", NULL};
+		check(parse(opt, args), "parse a command line with separate values");
+		check_str(opt.get_value_str("output"), "bar", "-o bar");
+		check(opt.get_value_int('c') == 2, "-c2 is -c with the value 2");
+		check(opt.is_true("verbose") && opt.is_true("all") && !opt.is_true('b'), "bundled flags -va");
+		check(opt.get_value_double('r') == 0.25, "--ratio=0.25");
+		check_str(opt.get_value_str("name"), "a=b", "--name=a=b splits at the first =");
+		check(opt.get_argc() == 0, "no non-option arguments");
+	}
+	{
+		Anyarg opt;
+		define_small(opt);
+		const char *args[] = {"prog", "--verb", "--out=x", "--", NULL};
+		check(parse(opt, args), "parse abbreviated long options");
+		check(opt.is_true("verbose"), "--verb is an abbreviation of --verbose");
+		check_str(opt.get_value_str('o'), "x", "--out=x is an abbreviation of --output=x");
+		check(opt.get_argc() == 0, "a trailing -- is not an argument");
+	}
+	{
+		Anyarg opt;
+		define_small(opt);
+		const char *args[] = {"prog", NULL};
+		check(parse(opt, args), "parse an empty command line");
+		check_str(opt.get_value_str('o'), "-", "default of --output");
+		check(opt.get_value_int("count") == 1 && opt.get_value_double("ratio") == 0.5, "defaults of numbers");
+		check(!opt.is_true("all"), "default of a flag");
+	}
+}
+
+
+// Options added from the table generated by anyarg-gen for example.spec: exact names through the perfect hash,
+// abbreviations through the generated name order
+static void test_generated()
+{
+	Anyarg opt;
+	example_add_options(opt);
+	const char *args[] = {"prog", "--buf", "7", "--min=0.25", "--input=in.txt", "-av", "x", NULL};
+	check(parse(opt, args), "parse with the generated options");
+	check(example_buffer_size(opt) == 7, "--buf is an abbreviation of --buffer-size");
+	check(example_min(opt) == 0.25, "--min by the perfect hash");
+	check_str(example_input_file(opt), "in.txt", "--input is an abbreviation of --input-file");
+	check(example_all(opt) && example_v(opt) && !example_help(opt), "letters by the generated table");
+	check(opt.get_argc() == 1, "a non-option argument with the generated options");
+}
+
+
+// Run parse_argv() on a command line in a child process, as errors exit, and check that the child exits with
+// status 1 and an error message containing msg
+static void check_error(void (*define)(Anyarg &), const char **args, const char *msg, const char *what)
+{
+	int fd[2];
+	if (pipe(fd) != 0) {
+		perror("pipe");
+		exit(1);
+	}
+	fflush(stdout);
+	fflush(stderr);
+	pid_t pid = fork();
+	if (pid == 0) {
+		close(fd[0]);
+		dup2(fd[1], 2);
+		Anyarg opt;
+		define(opt);
+		parse(opt, args);
+		_exit(0);
+	}
+	close(fd[1]);
+	string err;
+	char buf[256];
+	ssize_t n;
+	while ((n = read(fd[0], buf, sizeof(buf))) > 0) err.append(buf, n);
+	close(fd[0]);
+	int status = 0;
+	waitpid(pid, &status, 0);
+	int code = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+	if (code != 1 || err.find(msg) == string::npos) {
+		fprintf(stderr, "FAIL: %s: exit status %d, stderr \"%s\", expected status 1 and \"%s\"\n", what, code,
+		        err.c_str(), msg);
+		n_fail++;
+	}
+}
+
+static void define_groups(Anyarg &opt)
+{
+	define_small(opt);
+	opt.set_range("count", 1, 10);
+	opt.set_range('r', 0.0, 1.0);
+	opt.set_choices("name", "fast|slow|auto|fast");
+	opt.add_exclusive("--all -b");
+	opt.add_requires("--output", "--name -c");
+}
+
+static void define_bad_range(Anyarg &opt)
+{
+	define_small(opt);
+	opt.set_range("count", 5, 2);
+}
+
+
+// Ranges, choices, exclusive and required options
+static void test_groups()
+{
+	{
+		Anyarg opt;
+		define_groups(opt);
+		const char *args[] = {"prog", "-c", "10", "--ratio=0", "--name=auto", "-a", NULL};
+		check(parse(opt, args), "parse values within the constraints");
+		check(opt.get_value_int('c') == 10 && opt.get_value_double("ratio") == 0.0, "values at the ends of ranges");
+		check_str(opt.get_value_str("name"), "auto", "an accepted choice");
+	}
+	{
+		Anyarg opt;
+		define_groups(opt);
+		const char *args[] = {"prog", "--name", "fast", "-b", NULL};
+		check(parse(opt, args), "parse a choice listed twice");
+		check_str(opt.get_value_str("name"), "fast", "a choice listed twice is accepted");
+	}
+	{
+		Anyarg opt;
+		define_groups(opt);
+		const char *args[] = {"prog", "-o", "out", "--name=slow", "-c", "3", NULL};
+		check(parse(opt, args), "parse an option with its required options");
+		check_str(opt.get_value_str('o'), "out", "an option with its required options");
+	}
+
+	const char *over[] = {"prog", "--count=11", NULL};
+	check_error(define_groups, over, "the value of option --count is out of range [1, 10].", "a value over the range");
+	const char *under[] = {"prog", "-r", "-0.5", NULL};
+	check_error(define_groups, under, "the value of option --ratio is out of range [0, 1].", "a value under the range");
+	const char *choice[] = {"prog", "--name=turbo", NULL};
+	check_error(define_groups, choice, "invalid value turbo of option --name, valid values: fast|slow|auto|fast.",
+	            "a value out of the choices");
+	const char *both[] = {"prog", "-b", "--all", NULL};
+	check_error(define_groups, both, "option --all and -b cannot be given together.", "exclusive options");
+	const char *missed[] = {"prog", "-o", "out", "--name=fast", NULL};
+	check_error(define_groups, missed, "option --output requires option --count.", "a required option missed");
+	const char *none[] = {"prog", NULL};
+	check_error(define_bad_range, none, "invalid range [5, 2] of option --count.", "a range with lo > hi");
+}
+
+
+// Suggestions of the nearest long names for an unknown option
+static void test_suggestions()
+{
+	const char *swap[] = {"prog", "--verbsoe", NULL};
+	check_error(define_small, swap, "illegal option --verbsoe.\ndid you mean --verbose?", "a transposition");
+	const char *miss[] = {"prog", "--nme", NULL};
+	check_error(define_small, miss, "illegal option --nme.\ndid you mean --name?", "a short name with a letter missed");
+	const char *two[] = {"prog", "--ouptut=x", NULL};
+	check_error(define_small, two, "illegal option --ouptut.\ndid you mean --output?", "a miss with a value");
+}
+
+
+// Sizes and durations, by the parsers and through the options
+static void test_units()
+{
+	uint64_t size;
+	int64_t ns;
+	check(anyarg_detail::parse_size("10MB", &size) && size == 10000000ULL, "10MB is in powers of 1000");
+	check(anyarg_detail::parse_size("10M", &size) && size == 10ULL << 20, "10M is in powers of 1024");
+	check(anyarg_detail::parse_size("10MiB", &size) && size == 10ULL << 20, "10MiB is in powers of 1024");
+	check(anyarg_detail::parse_size("1kB", &size) && size == 1000, "1kB");
+	check(anyarg_detail::parse_size("4096", &size) && size == 4096, "a size without unit is in bytes");
+	check(!anyarg_detail::parse_size("1kb", &size), "1kb is rejected");
+	check(!anyarg_detail::parse_size("4Q", &size), "4Q is rejected");
+	check(!anyarg_detail::parse_size("", &size), "an empty size is rejected");
+	check(anyarg_detail::parse_size("16777215T", &size), "16777215T fits in 64 bits");
+	check(!anyarg_detail::parse_size("17179869184G", &size), "17179869184G overflows 64 bits");
+	check(!anyarg_detail::parse_size("99999999999999999999", &size), "a count overflowing 64 bits");
+
+	check(anyarg_detail::parse_duration("1h30m", &ns) && ns == 5400000000000LL, "1h30m");
+	check(anyarg_detail::parse_duration("90", &ns) && ns == 90000000000LL, "a bare count is in seconds");
+	check(anyarg_detail::parse_duration("250ms", &ns) && ns == 250000000LL, "250ms");
+	check(anyarg_detail::parse_duration("2min5s", &ns) && ns == 125000000000LL, "2min5s");
+	check(anyarg_detail::parse_duration("3us7ns", &ns) && ns == 3007, "3us7ns");
+	check(!anyarg_detail::parse_duration("1m30", &ns), "1m30 is rejected");
+	check(!anyarg_detail::parse_duration("", &ns), "an empty duration is rejected");
+	check(!anyarg_detail::parse_duration("5d", &ns), "5d is rejected");
+	check(!anyarg_detail::parse_duration("9999999999h", &ns), "9999999999h overflows 64 bits");
+
+	Anyarg opt;
+	opt.add_option_size("cache", 0, "64M", "Cache size.");
+	opt.add_option_duration("timeout", 't', "1s", "Timeout.");
+	opt.add_option_size("block", 0, "4K", "=BYTES Block size.");
+	const char *args[] = {"prog", "--cache=10MB", "-t", "1h30m", NULL};
+	check(parse(opt, args), "parse sizes and durations");
+	check(opt.get_value_size("cache") == 10000000ULL, "--cache=10MB");
+	check(opt.get_value_duration('t') == 5400000000000LL, "-t 1h30m");
+	check(opt.get_value_size("block") == 4096, "default size 4K");
+	const char *usage = opt.auto_usage();
+	check(strstr(usage, "--cache=SIZE") != NULL, "SIZE is the META word of a size");
+	check(strstr(usage, "--timeout=DURATION") != NULL, "DURATION is the META word of a duration");
+	check(strstr(usage, "--block=BYTES") != NULL, "a META word given in the description is kept");
+}
+
+
+// Output of export_options() into buffers of any size, without allocations
+static void test_export()
+{
+	Anyarg opt;
+	define_small(opt);
+	const char *args[] = {"prog", "-a", "--name=x y", "in", NULL};
+	check(parse(opt, args), "parse a command line to export");
+
+	char buf[4096], small[11];
+	long n0 = n_alloc;
+	int len = opt.export_options(ANYARG_EXPORT_KV, NULL, 0);
+	check(len > 0, "a NULL buffer of size 0 gives the length of the output");
+	check(opt.export_options(ANYARG_EXPORT_KV, buf, sizeof(buf)) == len && (int)strlen(buf) == len,
+	      "the whole output in a large buffer");
+	check(opt.export_options(ANYARG_EXPORT_KV, small, sizeof(small)) == len && strncmp(small, buf, 10) == 0 &&
+	      small[10] == 0, "the output truncated to a small buffer");
+	check(n_alloc == n0, "export_options() allocates nothing");
+	check(strstr(buf, "name=all letter=a type=flag source=command-line value=true\n") != NULL, "a flag in kv");
+	check(strstr(buf, "name=name letter= type=str source=command-line value=x y\n") != NULL, "a string in kv");
+	check(strstr(buf, "name=count letter=c type=int source=default value=1\n") != NULL, "a default in kv");
+	check(strstr(buf, "\narg=in\n") != NULL, "an argument in kv");
+
+	len = opt.export_options(ANYARG_EXPORT_JSON, NULL, 0);
+	check(opt.export_options(ANYARG_EXPORT_JSON, buf, sizeof(buf)) == len && (int)strlen(buf) == len,
+	      "the whole JSON output");
+	check(strncmp(buf, "{\"program\":\"prog\",\"options\":[{\"name\":\"all\",\"letter\":\"a\",\"type\":\"flag\","
+	              "\"value\":true,\"source\":\"command-line\"}", 90) == 0, "JSON output");
+	check(opt.export_options(ANYARG_EXPORT_JSON, -1) == false, "an invalid file descriptor");
+}
+
+
+// Allocation budgets on a small schema and a large one with all value types
+static void test_allocations()
+{
+	const int n = 1000;
+	vector<string> names, descs;
+	char s[64];
+	for (int i = 0; i < n; i++) {
+		snprintf(s, sizeof(s), "group%02d-option-%04d", i % 37, i);
+		names.push_back(s);
+		snprintf(s, sizeof(s), "=VALUE Description of option %d.", i);
+		descs.push_back(s);
+	}
+
+	long n0 = n_alloc;
+	::operator delete(::operator new(1));
+	check(n_alloc - n0 == 1, "the hooks count operator new");
+#ifdef HOOK_MALLOC
+	n0 = n_alloc;
+	free(malloc(1));
+	check(n_alloc - n0 == 1, "the hooks count malloc()");
+#endif
+
+	printf("allocations:\n");
+	{
+		long n0 = n_alloc;
+		Anyarg opt;
+		define_small(opt);
+		check_allocs(n0, 5, "7 add_* calls");
+
+		const char *args[] = {"prog", "-ab", "-ofoo", "--name=value", "-", "x", "--count", "3", NULL};
+		Argv a(args);
+		n0 = n_alloc;
+		a.parse(opt);
+		check_allocs(n0, 3, "parse_argv, small schema");
+
+		n0 = n_alloc;
+		long sum = 0;
+		for (int i = 0; i < 1000; i++) {
+			sum += opt.is_true('a') + opt.is_true("verbose") + strlen(opt.get_value_str("output"));
+			sum += opt.get_value_int('c') + (long)opt.get_value_double("ratio");
+		}
+		check_allocs(n0, 0, "5000 getter calls");
+		check(sum == 1000 * (1 + 0 + 3 + 3 + 0), "values read by the getters");
+
+		n0 = n_alloc;
+		opt.auto_usage();
+		check_allocs(n0, 1, "auto_usage, small schema");
+	}
+	{
+		long n0 = n_alloc;
+		Anyarg opt;
+		for (int i = 0; i < n; i++) {
+			const char *name = names[i].c_str(), *desc = descs[i].c_str();
+			switch (i % 6) {
+				case 0: opt.add_flag(name, 0, desc + 7); break;
+				case 1: opt.add_option_str(name, 0, "-", desc); break;
+				case 2: opt.add_option_int(name, 0, 0, desc); break;
+				case 3: opt.add_option_double(name, 0, 0.0, desc); break;
+				case 4: opt.add_option_size(name, 0, "4K", desc); break;
+				case 5: opt.add_option_duration(name, 0, "1s", desc); break;
+			}
+		}
+		check_allocs(n0, 2011, "1000 add_* calls");
+
+		string a0 = "--" + names[0], a1 = "--" + names[1] + "=foo", a2 = "--" + names[2];
+		string a4 = "--" + names[4] + "=64M", a5 = "--" + names[5] + "=250ms";
+		const char *args[] = {"prog", a0.c_str(), a1.c_str(), a2.c_str(), "42", a4.c_str(), a5.c_str(), "in", NULL};
+		Argv a(args);
+		n0 = n_alloc;
+		check(a.parse(opt), "parse a command line of the large schema");
+		check_allocs(n0, 3, "parse_argv, 1000 options");
+		check(opt.is_true(names[0].c_str()), "flag of the large schema");
+		check_str(opt.get_value_str(names[1].c_str()), "foo", "string of the large schema");
+		check(opt.get_value_int(names[2].c_str()) == 42, "integer of the large schema");
+		check(opt.get_value_size(names[4].c_str()) == 64ULL << 20, "size of the large schema");
+		check(opt.get_value_duration(names[5].c_str()) == 250000000LL, "duration of the large schema");
+
+		n0 = n_alloc;
+		long sum = 0;
+		for (int i = 0; i < 1000; i++) {
+			sum += opt.get_value_int(names[2].c_str()) + strlen(opt.get_value_str(names[7].c_str()));
+			sum += opt.get_value_size(names[10].c_str()) > 0;
+		}
+		check_allocs(n0, 0, "3000 getter calls, 1000 options");
+
+		n0 = n_alloc;
+		opt.auto_usage();
+		check_allocs(n0, 2, "auto_usage, 1000 options");
+	}
+}
+
+
+int main()
+{
+	test_parsing();
+	test_generated();
+	test_units();
+	test_groups();
+	test_suggestions();
+	test_export();
+	test_allocations();
+	if (n_fail) {
+		fprintf(stderr, "%d checks failed\n", n_fail);
+		return 1;
+	}
+	printf("all tests passed\n");
+	return 0;
+}